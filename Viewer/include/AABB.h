@@ -0,0 +1,112 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <limits>
+
+/*
+ * AABB struct.
+ * An axis aligned bounding box. The default one is empty (mins > maxs), so growing it by
+ * anything gives that thing's box.
+ */
+struct AABB
+{
+	glm::vec3 mins;
+	glm::vec3 maxs;
+
+	AABB() :
+		mins(std::numeric_limits<float>::max()),
+		maxs(-std::numeric_limits<float>::max())
+	{
+	}
+
+	AABB(const glm::vec3& mins, const glm::vec3& maxs) :
+		mins(mins),
+		maxs(maxs)
+	{
+	}
+
+	void Grow(const glm::vec3& point)
+	{
+		mins = glm::min(mins, point);
+		maxs = glm::max(maxs, point);
+	}
+
+	void Grow(const AABB& box)
+	{
+		mins = glm::min(mins, box.mins);
+		maxs = glm::max(maxs, box.maxs);
+	}
+
+	bool IsEmpty() const
+	{
+		return mins.x > maxs.x || mins.y > maxs.y || mins.z > maxs.z;
+	}
+
+	glm::vec3 GetCenter() const
+	{
+		return (mins + maxs) * 0.5f;
+	}
+
+	glm::vec3 GetExtent() const
+	{
+		return (maxs - mins) * 0.5f;
+	}
+
+	float GetSurfaceArea() const
+	{
+		if (IsEmpty())
+			return 0.0f;
+		glm::vec3 size = maxs - mins;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	bool Overlaps(const AABB& other) const
+	{
+		return mins.x <= other.maxs.x && maxs.x >= other.mins.x &&
+			mins.y <= other.maxs.y && maxs.y >= other.mins.y &&
+			mins.z <= other.maxs.z && maxs.z >= other.mins.z;
+	}
+
+	bool Contains(const glm::vec3& point) const
+	{
+		return mins.x <= point.x && point.x <= maxs.x &&
+			mins.y <= point.y && point.y <= maxs.y &&
+			mins.z <= point.z && point.z <= maxs.z;
+	}
+
+	bool operator==(const AABB& other) const
+	{
+		return mins == other.mins && maxs == other.maxs;
+	}
+
+	bool operator!=(const AABB& other) const
+	{
+		return !(*this == other);
+	}
+
+	// The box around this one after transform, which may rotate and scale it
+	AABB Transform(const glm::mat4& transform) const
+	{
+		glm::vec3 center = glm::vec3(transform * glm::vec4(GetCenter(), 1.0f));
+		glm::vec3 extent = GetExtent();
+		glm::vec3 worldExtent(0.0f);
+		for (int column = 0; column < 3; column++)
+		{
+			worldExtent += glm::abs(glm::vec3(transform[column])) * extent[column];
+		}
+		return AABB(center - worldExtent, center + worldExtent);
+	}
+
+	// Slab test: true if the ray origin + t * direction enters the box for some t in [0, maxDistance].
+	// inverseDirection is 1 / direction, computed once per ray
+	bool IntersectRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, float& distance) const
+	{
+		glm::vec3 t0 = (mins - origin) * inverseDirection;
+		glm::vec3 t1 = (maxs - origin) * inverseDirection;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+		float enter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+		float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+		distance = enter;
+		return enter <= exit;
+	}
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+
+struct BVHBenchmarkResult
+{
+	std::size_t objects;
+	std::size_t nodes;
+	int depth;
+	std::size_t visible;	// in the benchmark's frustum
+	double buildMs;
+	double refitMs;			// a tenth of the objects moved
+	double frustumMs;		// SceneBVH::QueryFrustum
+	double linearCullMs;	// Frustum::Cull over every box, for comparison
+	double rayMs;			// per 1000 rays
+	double boxMs;			// per 1000 box queries
+};
+
+/*
+ * BVHBenchmark class.
+ * Times SceneBVH on a procedurally populated scene: boxes of random sizes scattered in a cube that grows
+ * with their count, so the density stays the same. Nothing is drawn, only the CPU side is measured.
+ * Each time is the average of several runs.
+ */
+class BVHBenchmark
+{
+public:
+	static BVHBenchmarkResult Run(std::size_t objectCount, unsigned int seed = 1);
+};
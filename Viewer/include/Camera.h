@@ -2,6 +2,9 @@
 #include <memory>
 #include <glm/glm.hpp>
 #include "MeshModel.h"
+#include "CameraState.h"
+
+class ResourceManager;
 
 /*
  * Camera class. This class takes care of all the camera transformations and manipulations.
@@ -14,8 +17,7 @@
 class Camera: public MeshModel
 {
 private:
-	glm::mat4x4 viewTransformation;
-	glm::mat4x4 projectionTransformation;
+	CameraState state;
 
 public:
 	glm::vec3 eye;
@@ -34,9 +36,13 @@ public:
 	float l; // left
 	float r; // right
 
-	Camera(const glm::vec3& eye, const glm::vec3& at, const glm::vec3& up);
+	Camera(ResourceManager& resources, const glm::vec3& eye, const glm::vec3& at, const glm::vec3& up);
 	~Camera();
 
+	// the camera's mesh lives on the GPU, copies would duplicate (and leak) its buffers
+	Camera(const Camera& other) = delete;
+	Camera& operator=(const Camera& other) = delete;
+
 	void SetCameraLookAt(glm::vec3& eye, glm::vec3& at, glm::vec3& up);
 	void SetWorldTransformation(const glm::mat4x4 & worldTransform);
 	void SetWorldTransformation();
@@ -61,6 +67,7 @@ public:
 	void SetZoom(const float zoom);
 
 	// Add more methods/functionality as needed...
-	glm::mat4 GetViewTransformation() const;
-	glm::mat4 GetProjTransformation() const;
+	const glm::mat4& GetViewTransformation() const;
+	const glm::mat4& GetProjTransformation() const;
+	const CameraState& GetState() const;
 };
@@ -0,0 +1,15 @@
+#pragma once
+#include <glm/glm.hpp>
+
+/*
+ * CameraState struct.
+ * Everything the renderer needs from a camera, kept up to date by Camera itself, so it can be read
+ * by reference every frame without touching the camera's gizmo mesh.
+ */
+struct CameraState
+{
+	glm::mat4 view;			// the look-at transformation
+	glm::mat4 world;		// the inverse of the camera model's own world transformation
+	glm::mat4 projection;
+	glm::vec3 eye;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include "AABB.h"
+
+/*
+ * BoxList struct.
+ * World space axis aligned boxes as centers and half extents, one array per coordinate,
+ * so Frustum::Cull can load four boxes at a time.
+ */
+struct BoxList
+{
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+
+	void Clear();
+	void Add(const AABB& box);
+	std::size_t GetCount() const;
+};
+
+enum FrustumTest { FRUSTUM_OUTSIDE, FRUSTUM_INTERSECTS, FRUSTUM_INSIDE };
+
+/*
+ * Frustum class.
+ * The six planes of a view volume, extracted from a projection * view matrix. A plane (n, d) has the
+ * inside where dot(n, p) + d >= 0. A box is culled when it is entirely outside any plane: this keeps
+ * some boxes near the corners that are outside, but never drops one that is visible.
+ */
+class Frustum
+{
+private:
+	glm::vec4 planes[6];
+
+public:
+	Frustum();
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	void Set(const glm::mat4& viewProjection);
+	const glm::vec4& GetPlane(int index) const;
+
+	bool IsVisible(const glm::vec3& center, const glm::vec3& extent) const;
+
+	// Also tells boxes entirely inside apart, everything within those is visible without more tests
+	FrustumTest Classify(const AABB& box) const;
+
+	// visible[i] = 1 if box i is at least partly inside, else 0. Returns the number visible
+	std::size_t Cull(const BoxList& boxes, std::vector<unsigned char>& visible) const;
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include <glad/glad.h>
+
+/*
+ * GLHandle class.
+ * Owns one GL object name and deletes it when it goes away. Handles can be moved but not copied:
+ * a copy would either delete the object twice or have to duplicate it on the GPU.
+ * Traits supplies how the object is created and deleted, see the aliases below.
+ */
+template <typename Traits>
+class GLHandle
+{
+private:
+	GLuint handle;
+
+public:
+	GLHandle() : handle(0) {}
+	explicit GLHandle(GLuint handle) : handle(handle) {}
+	~GLHandle() { Reset(); }
+
+	GLHandle(const GLHandle& other) = delete;
+	GLHandle& operator=(const GLHandle& other) = delete;
+
+	GLHandle(GLHandle&& other) noexcept : handle(other.handle)
+	{
+		other.handle = 0;
+	}
+
+	GLHandle& operator=(GLHandle&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Reset(other.handle);
+			other.handle = 0;
+		}
+		return *this;
+	}
+
+	// Deletes the current object, if any, and creates a new one
+	void Create()
+	{
+		Reset(Traits::Create());
+	}
+
+	// Deletes the current object, if any, and takes ownership of newHandle
+	void Reset(GLuint newHandle = 0)
+	{
+		if (handle != 0)
+			Traits::Delete(handle);
+		handle = newHandle;
+	}
+
+	GLuint Get() const
+	{
+		return handle;
+	}
+};
+
+struct GLBufferTraits
+{
+	static GLuint Create() { GLuint handle; glGenBuffers(1, &handle); return handle; }
+	static void Delete(GLuint handle) { glDeleteBuffers(1, &handle); }
+};
+
+struct GLVertexArrayTraits
+{
+	static GLuint Create() { GLuint handle; glGenVertexArrays(1, &handle); return handle; }
+	static void Delete(GLuint handle) { glDeleteVertexArrays(1, &handle); }
+};
+
+struct GLTextureTraits
+{
+	static GLuint Create() { GLuint handle; glGenTextures(1, &handle); return handle; }
+	static void Delete(GLuint handle) { glDeleteTextures(1, &handle); }
+};
+
+struct GLProgramTraits
+{
+	static GLuint Create() { return glCreateProgram(); }
+	static void Delete(GLuint handle) { glDeleteProgram(handle); }
+};
+
+struct GLQueryTraits
+{
+	static GLuint Create() { GLuint handle; glGenQueries(1, &handle); return handle; }
+	static void Delete(GLuint handle) { glDeleteQueries(1, &handle); }
+};
+
+typedef GLHandle<GLBufferTraits> GLBuffer;
+typedef GLHandle<GLVertexArrayTraits> GLVertexArray;
+typedef GLHandle<GLTextureTraits> GLTexture;
+typedef GLHandle<GLProgramTraits> GLProgram;
+typedef GLHandle<GLQueryTraits> GLQuery;
@@ -0,0 +1,94 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include "GLHandle.h"
+#include "MeshResource.h"
+
+/*
+ * GeometryBuffer class.
+ * The only GPU copy of every mesh's triangles. Vertices are packed into one buffer per vertex format
+ * (Vertex, and CompactVertex for meshes that asked for it) and indices into one element buffer per
+ * index type (16 bit whenever the mesh has few enough vertices, 32 bit otherwise), with a VAO for each
+ * pairing, so drawing different meshes of one kind needs no VAO switch: a draw picks its mesh by the
+ * first index and the base vertex of its allocation. A mesh is added the first time it is asked for and
+ * uploaded from its RAM copies; like ResourceManager, the buffer only holds weak references, and the
+ * space of meshes gone away (or moved to the other vertex format) is reclaimed by Collect, which
+ * repacks the buffers once more than half of one is unused.
+ * To draw one mesh at a time there is also a VAO per mesh, its attributes starting at the mesh's first
+ * vertex. It refers to the same buffers, it holds no copy.
+ */
+class GeometryBuffer
+{
+public:
+	struct Allocation
+	{
+		std::weak_ptr<MeshResource> resource;
+		bool compact;				// in the CompactVertex buffer, else in the Vertex one
+		GLenum indexType;			// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, the element buffer it is in
+		GLint baseVertex;
+		std::uint32_t firstIndex;	// of the mesh's modelIndices, its levels of detail follow
+		std::uint32_t vertexCount;
+		std::uint32_t indexCount;
+	};
+
+private:
+	// one buffer, filled from the front; sizes are in elements
+	struct Pool
+	{
+		GLBuffer buffer;
+		std::size_t elementSize;
+		std::size_t capacity;
+		std::size_t count;		// used by live and dead allocations alike
+		std::size_t freeCount;	// of count, the part dead allocations still take
+
+		Pool();
+	};
+
+	Pool vertexPools[2];		// Vertex, CompactVertex
+	Pool indexPools[2];			// 16 bit, 32 bit
+	GLVertexArray vaos[2][2];	// by vertex pool, then by index pool
+	std::unordered_map<const MeshResource*, Allocation> allocations;
+	std::unordered_map<const MeshResource*, GLVertexArray> meshVaos;	// made by GetMeshVAO, dropped when the mesh moves
+
+	static int GetIndexPool(GLenum indexType);
+	// Points attributes 0 to 2 of the bound VAO at the bound array buffer, starting offset bytes in
+	static void SetVertexFormat(bool compact, std::size_t offset);
+	// Whether allocation is still in the vertex format resource draws with
+	static bool Matches(const Allocation& allocation, const MeshResource& resource);
+	// Grows pool to hold needed elements and empties it
+	static void Respecify(Pool& pool, std::size_t needed);
+
+	// Drops dead allocations, respecifies the buffers with room for extra more vertices in vertexPool
+	// and indices in indexPool, and uploads every live one again from the front. Allocations that stay
+	// keep their map entries
+	void Repack(int vertexPool, std::size_t extraVertices, int indexPool, std::size_t extraIndices);
+	void Upload(const MeshResource& resource, const Allocation& allocation) const;
+	std::unordered_map<const MeshResource*, Allocation>::iterator Free(std::unordered_map<const MeshResource*, Allocation>::iterator it);
+
+public:
+	GeometryBuffer();
+
+	// Needs the context
+	void Create();
+
+	// The allocation of resource, added if it is new or in the wrong vertex format. Adding may repack
+	// the buffers, which moves the other allocations: their entries are updated in place
+	const Allocation* Find(const std::shared_ptr<MeshResource>& resource);
+
+	// Forgets the meshes that went away or changed their vertex format, call once a frame before any Find
+	void Collect();
+
+	// The shared VAO allocation is drawn from with its base vertex
+	GLuint GetVAO(const Allocation& allocation) const;
+	// A VAO of resource's own over the same buffers, drawn from without a base vertex. resource has to
+	// have been found since the last Collect
+	GLuint GetMeshVAO(const MeshResource& resource);
+	std::size_t GetMeshCount() const;
+
+	// Bytes the vertices and indices of live meshes take, and what the buffers hold
+	std::size_t GetUsedSize() const;
+	std::size_t GetCapacity() const;
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/*
+ * HandoffQueue class.
+ * A bounded, lock-free queue for exactly one producer thread and one consumer thread.
+ * The producer only ever writes tail and the consumer only ever writes head, so no locks are needed;
+ * the release/acquire pairs make an item's contents visible before its slot is.
+ */
+template <typename T, std::size_t Capacity>
+class HandoffQueue
+{
+private:
+	// one slot is always left empty to tell a full queue from an empty one
+	T slots[Capacity + 1];
+	std::atomic<std::size_t> head;
+	std::atomic<std::size_t> tail;
+
+public:
+	HandoffQueue() :
+		head(0),
+		tail(0)
+	{
+	}
+
+	// Producer side. Returns false (and leaves item alone) if the queue is full.
+	bool Push(T&& item)
+	{
+		std::size_t currentTail = tail.load(std::memory_order_relaxed);
+		std::size_t nextTail = (currentTail + 1) % (Capacity + 1);
+		if (nextTail == head.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		slots[currentTail] = std::move(item);
+		tail.store(nextTail, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side. Returns false if the queue is empty.
+	bool Pop(T& item)
+	{
+		std::size_t currentHead = head.load(std::memory_order_relaxed);
+		if (currentHead == tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		item = std::move(slots[currentHead]);
+		head.store((currentHead + 1) % (Capacity + 1), std::memory_order_release);
+		return true;
+	}
+};
@@ -2,6 +2,9 @@
 #include <imgui/imgui.h>
 #include "Scene.h"
 #include "Renderer.h"
+#include "MeshLoader.h"
+#include "TextureLoader.h"
+#include "ResourceManager.h"
 
-void DrawImguiMenus(ImGuiIO& io, Scene& scene, Renderer& renderer);
+void DrawImguiMenus(ImGuiIO& io, Scene& scene, Renderer& renderer, MeshLoader& loader, TextureLoader& textureLoader, ResourceManager& resources);
 const glm::vec4& GetClearColor();
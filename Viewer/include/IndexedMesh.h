@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * IndexedMesh struct.
+ * The triangles of a model as flat, 0-based index streams (structure of arrays).
+ * Corner j of triangle i is entry 3 * i + j of every stream, so all three streams always have the same length.
+ * A corner without a normal / texture coordinate holds NoIndex in that stream.
+ */
+struct IndexedMesh
+{
+	static constexpr std::uint32_t NoIndex = 0xFFFFFFFFu;
+
+	std::vector<std::uint32_t> positionIndices;
+	std::vector<std::uint32_t> normalIndices;
+	std::vector<std::uint32_t> textureIndices;
+
+	std::size_t GetTriangleCount() const { return positionIndices.size() / 3; }
+	std::size_t GetCornerCount() const { return positionIndices.size(); }
+};
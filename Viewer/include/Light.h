@@ -2,9 +2,11 @@
 #include <glm/glm.hpp>
 #include "MeshModel.h"
 
+class ResourceManager;
+
 class Light : public MeshModel {
 private:
 public:
 	int isPoint;
-	Light();
+	explicit Light(ResourceManager& resources);
 };
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+/*
+ * LoadProgress class.
+ * Shared between a thread that loads a model and the UI thread: the loader reports how far it got,
+ * the UI reads it for a progress bar and may ask the loader to stop early.
+ */
+class LoadProgress
+{
+private:
+	// share of the progress bar that belongs to parsing, the rest is normals and vertex expansion
+	static const float ParseShare;
+
+	std::atomic<float> fraction;
+	std::atomic<bool> cancelled;
+	std::atomic<std::size_t> parsedBytes;
+	std::size_t totalBytes;
+
+public:
+	LoadProgress();
+
+	void Reset();
+
+	// loader side
+	void StartParsing(std::size_t totalBytes);
+	void AddParsedBytes(std::size_t bytes);
+	void SetFraction(float fraction);
+
+	// UI side
+	float GetFraction() const;
+	void Cancel();
+	bool IsCancelled() const;
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+/*
+ * MappedFile class.
+ * A read-only memory mapping of a whole file. The contents are paged in by the OS on demand,
+ * so parsers can walk the bytes in place instead of copying them through a stream.
+ */
+class MappedFile
+{
+private:
+	const char* data;
+	std::size_t size;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+public:
+	MappedFile();
+	MappedFile(const std::string& filePath);
+	~MappedFile();
+
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile& operator=(const MappedFile& other) = delete;
+
+	bool Open(const std::string& filePath);
+	void Close();
+
+	bool IsOpen() const;
+	const char* GetData() const;
+	std::size_t GetSize() const;
+};
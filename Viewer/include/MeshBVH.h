@@ -0,0 +1,55 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+struct Vertex;
+
+/*
+ * MeshBVH class.
+ * A bounding volume hierarchy over the triangles of a mesh, in the mesh's own space, for picking.
+ * Nodes take 32 bytes and are stored depth first: a node's left child comes right after it, so only
+ * the right one needs an index. Every leaf holds up to four triangles, in one TrianglePacket laid
+ * out as structure of arrays, which a ray is tested against four at a time with SSE.
+ */
+class MeshBVH
+{
+public:
+	struct Node
+	{
+		float mins[3];
+		std::uint32_t offset;	// inner: the right child. leaf: the packet
+		float maxs[3];
+		std::uint32_t count;	// triangles in the leaf, 0 for an inner node
+	};
+
+	// One vertex and the two edges from it per triangle; lanes past the leaf's count are all zero and never hit
+	struct TrianglePacket
+	{
+		float v0[3][4];
+		float edge1[3][4];
+		float edge2[3][4];
+		std::uint32_t triangles[4];
+	};
+
+	static const std::uint32_t NoTriangle = 0xffffffffu;
+	static const std::uint32_t MaxLeafSize = 4;
+	static const int BinCount = 8;
+
+private:
+	std::vector<Node> nodes;
+	std::vector<TrianglePacket> packets;
+
+public:
+	MeshBVH();
+
+	void Build(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices);
+
+	// The triangle origin + t * direction hits first, for t in [0, maxDistance], from either side.
+	// NoTriangle if none, else distance is its t. direction needs no normalizing, t is in its units
+	std::uint32_t Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance) const;
+
+	std::size_t GetNodeCount() const;
+	std::size_t GetMemorySize() const;
+};
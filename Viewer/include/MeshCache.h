@@ -0,0 +1,101 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "MappedFile.h"
+#include "MeshModel.h"
+
+/*
+ * MeshCacheHeader struct.
+ * The first bytes of a .meshbin file. The arrays follow it in the order of the counts below,
+ * each one starting at a 16 byte aligned offset.
+ */
+struct MeshCacheHeader
+{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t vertexSize;
+	std::uint32_t flags;
+
+	// the key: which source file this cache was built from, and what it looked like back then
+	std::uint64_t pathHash;
+	std::uint64_t sourceSize;
+	std::int64_t sourceTime;
+	std::uint64_t sourceHash;
+
+	glm::vec4 mins;
+	glm::vec4 maxs;
+	glm::vec3 avg;
+	VertexCacheStats originalCacheStats;
+
+	std::uint64_t modelVertexCount;
+	std::uint64_t modelIndexCount;
+	std::uint64_t vertexCount;
+	std::uint64_t normalCount;
+	std::uint64_t textureCoordCount;
+	std::uint64_t cornerCount;
+	std::uint64_t lodIndexCount;
+	std::uint64_t lodCount;
+};
+
+/*
+ * MeshCache class.
+ * A binary snapshot of an imported model, stored next to its source file as <source>.meshbin, or as
+ * <source>.opt.meshbin once MeshOptimizer ran on it: both orders can be cached side by side.
+ * It holds the whole MeshData of the model (the welded Vertex and element arrays, the levels of detail,
+ * the bounds and the vertex normals), so later loads map it and skip parsing, normal generation and
+ * simplification altogether.
+ *
+ * A cache is used only if it matches the source's path, size and modification time. If only the
+ * time differs (e.g. the file was copied or checked out again) the source content hash decides, and
+ * the caller stamps the cache with the new time through Restamp, so the source is hashed only once.
+ */
+class MeshCache
+{
+private:
+	static const std::uint32_t Version = 5;
+	enum Flags { OPTIMIZED = 1 };
+
+	enum Section { MODEL_VERTICES, MODEL_INDICES, VERTICES, NORMALS, TEXTURE_COORDS, POSITION_INDICES, NORMAL_INDICES, TEXTURE_INDICES, LOD_INDICES, LODS, SectionCount };
+
+	MappedFile file;
+	const MeshCacheHeader* header;
+	std::size_t offsets[SectionCount + 1];
+	bool staleTime;
+
+	static std::uint64_t HashBytes(const char* data, std::size_t size);
+	static std::size_t Align(std::size_t offset);
+	static void ComputeSizes(const MeshCacheHeader& header, std::size_t sizes[SectionCount]);
+	static void ComputeOffsets(const MeshCacheHeader& header, std::size_t offsets[SectionCount + 1]);
+	static bool GetSourceKey(const std::string& sourcePath, std::uint64_t& pathHash, std::uint64_t& size, std::int64_t& time);
+
+public:
+	MeshCache();
+
+	static std::string GetCachePath(const std::string& sourcePath, bool optimized);
+
+	// Maps the cache of sourcePath in the optimized order or the file's, returns false if there is none
+	// or it is stale
+	bool Open(const std::string& sourcePath, bool optimized);
+	static bool Write(const std::string& sourcePath, const MeshData& data);
+	// Whether the open cache matched by content hash only. Restamp it once it is closed
+	bool HasStaleTime() const;
+	// Writes the source's modification time into the header of its cache, leaving the rest as it is
+	static bool Restamp(const std::string& sourcePath, bool optimized);
+
+	// Copies the mapped arrays out into data
+	void Read(MeshData& data) const;
+
+	const MeshCacheHeader& GetHeader() const;
+	const Vertex* GetModelVertices() const;
+	const std::uint32_t* GetModelIndices() const;
+	const glm::vec3* GetVertices() const;
+	const glm::vec3* GetNormals() const;
+	const glm::vec2* GetTextureCoords() const;
+	const std::uint32_t* GetPositionIndices() const;
+	const std::uint32_t* GetNormalIndices() const;
+	const std::uint32_t* GetTextureIndices() const;
+	const std::uint32_t* GetLodIndices() const;
+	const MeshLod* GetLods() const;
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include "HandoffQueue.h"
+#include "LoadProgress.h"
+#include "MeshModel.h"
+
+class Scene;
+class ResourceManager;
+
+/*
+ * MeshLoader class.
+ * Loads models without stalling the render loop. Parsing, normal generation and vertex expansion run on
+ * a worker thread; finished meshes are handed to the main thread through a lock-free queue, and Poll()
+ * uploads them to the GPU and adds them to the scene at a frame boundary.
+ * One model is loaded at a time.
+ */
+class MeshLoader
+{
+private:
+	struct LoadedMesh
+	{
+		std::string name;
+		std::string fileKey;
+		std::uint64_t hash;
+		bool failed;	// nothing but the name is set then
+		MeshData data;
+	};
+
+	ResourceManager& resources;
+	std::vector<std::shared_ptr<MeshModel>> resident;
+	std::thread worker;
+	std::atomic<bool> busy;
+	std::string loadingFile;
+	std::string error;
+	LoadProgress progress;
+	HandoffQueue<std::unique_ptr<LoadedMesh>, 4> finished;
+
+	void Run(std::string filePath, std::string fileKey, bool optimize);
+
+public:
+	explicit MeshLoader(ResourceManager& resources);
+	~MeshLoader();
+
+	MeshLoader(const MeshLoader& other) = delete;
+	MeshLoader& operator=(const MeshLoader& other) = delete;
+
+	// Starts loading filePath in the background, returns false if another load is still running.
+	// optimize runs MeshOptimizer on the result (see Utils::LoadMeshData).
+	// Meshes already resident in resources skip loading and are added by the next Poll.
+	bool Load(const std::string& filePath, bool optimize = false);
+	void Cancel();
+
+	bool IsLoading() const;
+	float GetProgress() const;
+	const std::string& GetLoadingFile() const;
+
+	// Why the last load failed, set by Poll; empty once a load succeeds or a new one starts
+	const std::string& GetError() const;
+
+	// Main (GL) thread only: turns finished meshes into models, shared through resources, and adds them to the scene
+	void Poll(Scene& scene);
+};
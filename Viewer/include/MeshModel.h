@@ -1,33 +1,23 @@
 #pragma once
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <string>
 #include <memory>
-#include "MeshModel.h"
-#include "Face.h"
+#include "MeshResource.h"
 #include "Texture2D.h"
 
-struct Vertex
-{
-	glm::vec3 position;
-	glm::vec3 normal;
-	glm::vec2 textureCoords;
-};
-
+// How texture coordinates are made: ORIGINAL uses the mesh's own, the others are generated from
+// the model space position by vshader.glsl
 enum Proj { ORIGINAL, PLANAR, SPHERICAL, CYLINDRICAL };
 
 class MeshModel {
 private:
-	std::vector<Face> faces;
-	std::vector<glm::vec3> vertices;
-	std::vector<glm::vec3> normals;
-	std::vector<glm::vec2> textureCoords;
-	std::vector<Vertex> modelVertices;
-	std::vector<Vertex> boundingBoxVertices;
-	std::vector<Vertex> vertexNormals;
+	// shared with every other model drawing the same geometry
+	std::shared_ptr<MeshResource> resource;
 	glm::mat4x4 worldTransform;
 	std::string modelName;
-	Texture2D texture;
+	std::shared_ptr<Texture2D> texture;
 
 public:
 	bool showVertexNormals;
@@ -37,6 +27,7 @@ public:
 	bool showWire;
 	bool loadedTexture;
 	bool useTexture;
+	int textureProjection;	// a Proj, applies while useTexture is set
 
 	glm::vec3 scale;
 	glm::vec3 rotation;
@@ -52,31 +43,28 @@ public:
 	float Ks;
 	int alpha;
 
-	GLuint vao; // vertex array object
-	GLuint vbo; // vertex buffers object
-	GLuint boxVao;
-	GLuint boxVbo;
-	GLuint normalVao;
-	GLuint normalVbo;
+	// the level of detail Renderer draws; it depends on the last one, so changes don't flicker
+	int lodLevel;
 
-	MeshModel() {};
-	MeshModel(const std::vector<Face>& faces, const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals, std::vector<glm::vec2> textureCoords, const std::string& modelName = "");
-	MeshModel(const MeshModel& other);
+	MeshModel(MeshData&& data, const std::string& modelName = "");
+	MeshModel(const std::shared_ptr<MeshResource>& resource, const std::string& modelName = "");
 	virtual ~MeshModel();
 
-	void InitOpenGL(GLuint* vao, GLuint* vbo, std::vector<Vertex>& vertices);
+	MeshModel(const MeshModel& other) = delete;
+	MeshModel& operator=(const MeshModel& other) = delete;
+	MeshModel(MeshModel&& other) = default;
+	MeshModel& operator=(MeshModel&& other) = default;
 
-	void UpdateModelVerticesData(std::vector<Vertex>& newVertices);
+	// Switches the vertex buffer between Vertex and the 16 byte CompactVertex. The buffer is shared,
+	// so this applies to every model drawing the same mesh.
+	void SetCompactVertices(bool compact);
+	bool HasCompactVertices() const;
+	std::size_t GetVertexSize() const;
 
 	void LoadBombingTexture();
 
-	void ChangeTextureProjection(int type);
-
-	void PopulateBoundingBoxVertices();
-	void PopulateVertexNormals();
-
-	std::vector<Vertex>& GetBoundingBoxVertices();
-	std::vector<Vertex>& GetVertexNormals();
+	const std::vector<Vertex>& GetBoundingBoxVertices() const;
+	const std::vector<Vertex>& GetVertexNormals() const;
 
 	void SetWorldTransformation();
 	virtual void SetWorldTransformation(const glm::mat4x4& worldTransform);
@@ -90,9 +78,10 @@ public:
 	void SetModelName(std::string name);
 
 	// Add more methods/functionality as needed...
-	const std::vector<glm::vec3> GetVertices() const;
+	const std::vector<glm::vec3>& GetVertices() const;
 	const std::vector<glm::vec3>& GetNormals() const;
-	const std::vector<Face>& GetFaces() const;
+	const std::vector<glm::vec2>& GetTextureCoords() const;
+	const IndexedMesh& GetMesh() const;
 
 	const glm::vec4 GetMin() const;
 	const glm::vec4 GetMax() const;
@@ -104,10 +93,30 @@ public:
 	void SetRotation(glm::vec3 _r);
 	void SetTranslation(glm::vec3 _t);
 
-	GLuint GetVAO() const;
-	const std::vector<Vertex>& GetModelVertices();
-
-	void LoadTexture(const char * path);
-	void BindTexture();
-	void UnbindTexture();
+	const std::shared_ptr<MeshResource>& GetMeshResource() const;
+	GLuint GetBoundingBoxVAO() const;
+	GLuint GetVertexNormalsVAO() const;
+	const std::vector<Vertex>& GetModelVertices() const;
+	const std::vector<std::uint32_t>& GetModelIndices() const;
+	GLsizei GetIndexCount() const;
+	GLenum GetIndexType() const;
+	std::size_t GetIndexSize() const;
+	int GetLodCount() const;
+	const MeshLod& GetLod(int level) const;
+
+	// Memory the mesh takes on the GPU (its share of GeometryBuffer and the helper lines), everything
+	// kept in RAM (the source arrays and index streams included), and what one Vertex per corner would take
+	std::size_t GetVideoMemorySize() const;
+	std::size_t GetSystemMemorySize() const;
+	std::size_t GetUnindexedMemorySize() const;
+
+	bool IsOptimized() const;
+	const VertexCacheStats& GetCacheStats() const;
+	const VertexCacheStats& GetOriginalCacheStats() const;
+	const MeshBVH& GetTriangleBVH() const;
+
+	void SetTexture(const std::shared_ptr<Texture2D>& texture);
+	const std::shared_ptr<Texture2D>& GetTexture() const;
+	void BindTexture() const;
+	void UnbindTexture() const;
 };
@@ -0,0 +1,37 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshModel.h"
+#include "VertexCacheStats.h"
+
+/*
+ * MeshOptimizer class.
+ * Reorders the welded vertex and index buffers of a model for the GPU, without changing what is drawn:
+ *	1. triangles for the post-transform vertex cache (Tipsify, Sander et al. 2007)
+ *	2. clusters of those triangles for overdraw, outward facing ones first (relative to the bounds center)
+ *	3. vertices in the order the triangles first use them, for fetch locality
+ */
+class MeshOptimizer
+{
+private:
+	static std::size_t BuildSoftClusters(const std::vector<std::uint32_t>& indices, std::size_t vertexCount, const std::vector<std::uint32_t>& hardClusters, float threshold, std::vector<std::uint32_t>& clusters);
+
+public:
+	// The cache size the optimization targets and the statistics simulate
+	static constexpr unsigned int CacheSize = 16;
+
+	// Runs all three passes on the model buffers of data, recording the statistics from before
+	static void Optimize(MeshData& data);
+
+	static VertexCacheStats AnalyzeVertexCache(const std::vector<std::uint32_t>& indices, std::size_t vertexCount, unsigned int cacheSize = CacheSize);
+
+	// clusters receives the first triangle of every run that starts with an empty (flushed) cache
+	static void OptimizeVertexCache(std::vector<std::uint32_t>& indices, std::size_t vertexCount, std::vector<std::uint32_t>* clusters = nullptr);
+
+	// threshold is how much worse than its cluster's ACMR a split-off piece may get
+	static void OptimizeOverdraw(std::vector<std::uint32_t>& indices, const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& clusters, const glm::vec3& center, float threshold = 1.05f);
+
+	static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices);
+};
@@ -0,0 +1,158 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "IndexedMesh.h"
+#include "VertexCacheStats.h"
+#include "GLHandle.h"
+#include "MeshBVH.h"
+
+struct Vertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 textureCoords;
+};
+
+/*
+ * CompactVertex struct.
+ * The opt-in GPU layout of a Vertex, see VertexQuantizer. position[3] only pads every attribute
+ * to a 4 byte boundary.
+ */
+struct CompactVertex
+{
+	std::uint16_t position[4];
+	std::int16_t normal[2];
+	std::uint16_t textureCoords[2];
+};
+
+/*
+ * MeshLod struct.
+ * One level of detail of a mesh: a range of its element buffer, which holds modelIndices and then lodIndices.
+ */
+struct MeshLod
+{
+	std::uint32_t firstIndex;
+	std::uint32_t indexCount;
+};
+
+/*
+ * MeshData struct.
+ * Everything a MeshModel is built from, on the CPU side only. It can be filled on any thread;
+ * turning it into a MeshModel uploads it to the GPU, which must happen on the GL thread.
+ */
+struct MeshData
+{
+	IndexedMesh mesh;
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> textureCoords;
+
+	// the welded GPU geometry: unique vertices, and three indices into them per triangle
+	std::vector<Vertex> modelVertices;
+	std::vector<std::uint32_t> modelIndices;
+	glm::vec4 mins;
+	glm::vec4 maxs;
+	glm::vec3 avg;
+
+	// coarser index buffers into modelVertices, from MeshSimplifier; lods[0] is modelIndices itself
+	std::vector<std::uint32_t> lodIndices;
+	std::vector<MeshLod> lods;
+
+	// set once MeshOptimizer reordered the model buffers, with the cache statistics from before
+	bool optimized = false;
+	VertexCacheStats originalCacheStats;
+};
+
+/*
+ * MeshResource class.
+ * The geometry of a model: everything that stays the same however many models draw it. ResourceManager
+ * shares one between every model loaded from the same file (or from identical content), MeshModel adds
+ * what is per model on top (transformation, material, texture). Its triangles are on the GPU once, in
+ * the Renderer's GeometryBuffer; only the bounding box and normal lines have buffers of their own.
+ */
+class MeshResource
+{
+private:
+	IndexedMesh mesh;
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> textureCoords;
+	std::vector<Vertex> modelVertices;
+	std::vector<std::uint32_t> modelIndices;
+	std::vector<std::uint32_t> lodIndices;
+	std::vector<MeshLod> lods;
+	GLenum indexType;	// 16 bit whenever every vertex can be reached by one, it halves the indices
+	bool compactVertices;
+	bool optimized;
+	VertexCacheStats cacheStats;
+	VertexCacheStats originalCacheStats;
+	std::vector<Vertex> boundingBoxVertices;
+	std::vector<Vertex> vertexNormals;
+	glm::vec4 mins;
+	glm::vec4 maxs;
+	glm::vec3 avg;
+
+	// built on the first pick, most meshes never need one
+	mutable std::unique_ptr<MeshBVH> triangleBVH;
+
+	GLVertexArray boxVao;
+	GLBuffer boxVbo;
+	GLVertexArray normalVao;
+	GLBuffer normalVbo;
+
+	void InitOpenGL(GLVertexArray& vao, GLBuffer& vbo, const std::vector<Vertex>& vertices);
+
+	void PopulateBoundingBoxVertices();
+	void PopulateVertexNormals();
+
+public:
+	explicit MeshResource(MeshData&& data);
+
+	MeshResource(const MeshResource& other) = delete;
+	MeshResource& operator=(const MeshResource& other) = delete;
+
+	// Switches the GPU vertices between Vertex and the 16 byte CompactVertex
+	void SetCompactVertices(bool compact);
+	bool HasCompactVertices() const;
+	std::size_t GetVertexSize() const;
+
+	const std::vector<glm::vec3>& GetVertices() const;
+	const std::vector<glm::vec3>& GetNormals() const;
+	const std::vector<glm::vec2>& GetTextureCoords() const;
+	const IndexedMesh& GetMesh() const;
+	const glm::vec4& GetMin() const;
+	const glm::vec4& GetMax() const;
+	const glm::vec3& GetAverage() const;
+
+	const std::vector<Vertex>& GetBoundingBoxVertices() const;
+	const std::vector<Vertex>& GetVertexNormals() const;
+
+	GLuint GetBoundingBoxVAO() const;
+	GLuint GetVertexNormalsVAO() const;
+	const std::vector<Vertex>& GetModelVertices() const;
+	const std::vector<std::uint32_t>& GetModelIndices() const;
+	const std::vector<std::uint32_t>& GetLodIndices() const;
+	GLsizei GetIndexCount() const;
+	GLenum GetIndexType() const;
+	std::size_t GetIndexSize() const;
+
+	// Level 0 is the full mesh, every next one coarser. There is always at least one
+	int GetLodCount() const;
+	const MeshLod& GetLod(int level) const;
+
+	// Memory the mesh takes on the GPU (its share of GeometryBuffer and the helper lines), everything
+	// kept in RAM (the source arrays and index streams included), and what one Vertex per corner would take
+	std::size_t GetVideoMemorySize() const;
+	std::size_t GetSystemMemorySize() const;
+	std::size_t GetUnindexedMemorySize() const;
+
+	bool IsOptimized() const;
+	const VertexCacheStats& GetCacheStats() const;
+	const VertexCacheStats& GetOriginalCacheStats() const;
+
+	// The triangles of the welded mesh in a MeshBVH, in model space. Built by the first call
+	const MeshBVH& GetTriangleBVH() const;
+};
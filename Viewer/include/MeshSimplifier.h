@@ -0,0 +1,63 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshModel.h"
+
+/*
+ * MeshSimplifier class.
+ * Reduces a mesh by edge collapses ordered by the quadric error metric (Garland and Heckbert 1997).
+ * A vertex is only ever moved onto a neighbor, so every level of detail is an index buffer into the
+ * same vertices. Vertices on open borders and on attribute seams (several vertices at one position)
+ * stay where they are, so holes don't grow and textures don't tear. Collapses run in passes: each
+ * pass takes the cheapest ones whose neighborhoods don't overlap, and rejects any that flips a triangle.
+ * Simplify can be called again with a lower target, the quadrics carry over, that is how the chain
+ * of BuildLods is made.
+ */
+class MeshSimplifier
+{
+private:
+	struct Quadric
+	{
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+	};
+
+	struct Collapse
+	{
+		float cost;
+		std::uint32_t from;
+		std::uint32_t to;
+	};
+
+	const std::vector<Vertex>& vertices;
+	std::vector<std::uint32_t> indices;
+	std::vector<Quadric> quadrics;			// one per position, see positions
+	std::vector<std::uint32_t> positions;	// the first vertex at each vertex's position
+	std::vector<unsigned char> locked;
+	std::vector<std::uint32_t> remap;
+
+	// the plane ax + by + cz + d = 0, (a, b, c) of unit length
+	static void AddPlane(Quadric& quadric, double a, double b, double c, double d, double weight);
+	static void Add(Quadric& quadric, const Quadric& other);
+	static double Evaluate(const Quadric& quadric, const glm::vec3& point);
+
+	float GetCost(std::uint32_t from, std::uint32_t to) const;
+	bool RunPass(std::size_t targetTriangles);
+
+public:
+	// BuildLods makes at most MaxLods levels, the full mesh included
+	static const int MaxLods = 5;
+	static const std::size_t MinLodTriangles = 64;
+
+	MeshSimplifier(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices);
+
+	// Collapses edges until at most targetTriangles are left, or no collapse is possible. Returns the triangle count
+	std::size_t Simplify(std::size_t targetTriangles);
+	const std::vector<std::uint32_t>& GetIndices() const;
+
+	// Fills data.lods and data.lodIndices: level 0 is modelIndices, each next one has about a quarter of
+	// the triangles of the one before, as long as it has MinLodTriangles. Slow on big meshes, meant for
+	// the loading thread
+	static void BuildLods(MeshData& data);
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include "IndexedMesh.h"
+#include "LoadProgress.h"
+
+/*
+ * ObjData struct.
+ * The raw streams of a Wavefront OBJ file, with every polygon fan-triangulated into mesh.
+ */
+struct ObjData
+{
+	enum { RELATIVE_POSITION = 1, RELATIVE_TEXTURE = 2, RELATIVE_NORMAL = 4 };
+
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> textureCoords;
+	IndexedMesh mesh;
+
+	// One entry per mesh corner while parsing: which of its indices were written as negative (relative) indices.
+	// Only needed to merge chunks, ParseBuffer releases it when done.
+	std::vector<unsigned char> relativeCorners;
+};
+
+/*
+ * ObjParser class.
+ * Parses OBJ files in place over a memory mapping: no streams, no per-line strings.
+ * Numbers are read with std::from_chars straight out of the mapped bytes.
+ *
+ * Large files are split into newline aligned chunks that are parsed on all cores.
+ * The chunks are then merged with a prefix sum over their element counts, which also
+ * resolves relative (negative) indices that point back into earlier chunks.
+ * Only then can indices be checked against the element counts: triangles with a position out of
+ * range are dropped, texture coordinate and normal indices out of range become NoIndex.
+ */
+class ObjParser
+{
+public:
+	// Files smaller than this are never split
+	static const std::size_t MinChunkSize = 256 * 1024;
+
+	// Parsing progress is reported every this many bytes, which is also how often cancellation is checked
+	static const std::size_t ProgressInterval = 1024 * 1024;
+
+	// threadCount == 0 uses all hardware threads, threadCount == 1 parses serially.
+	// If progress is given, it is updated while parsing and a cancelled parse stops early.
+	static bool ParseFile(const std::string& filePath, ObjData& data, unsigned int threadCount = 0, LoadProgress* progress = nullptr);
+	static void ParseBuffer(const char* begin, const char* end, ObjData& data, unsigned int threadCount = 0, LoadProgress* progress = nullptr);
+
+private:
+	static void ParseChunk(const char* begin, const char* end, ObjData& data, LoadProgress* progress);
+	static void MergeChunks(std::vector<ObjData>& chunks, ObjData& data);
+	static void DropInvalidIndices(ObjData& data);
+};
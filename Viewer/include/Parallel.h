@@ -0,0 +1,39 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Runs task(0) .. task(count - 1), each on its own thread. Task 0 runs on the calling thread.
+template <typename Task>
+inline void RunParallel(unsigned int count, Task task)
+{
+	std::vector<std::thread> workers;
+	workers.reserve(count);
+
+	for (unsigned int i = 1; i < count; i++)
+		workers.emplace_back(task, i);
+
+	task(0);
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+// How many ranges to split size items into: one per thread, but none smaller than minRangeSize
+inline unsigned int GetParallelRangeCount(std::size_t size, std::size_t minRangeSize, unsigned int threadCount = 0)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	return (unsigned int)std::min<std::size_t>(threadCount, std::max<std::size_t>(1, size / minRangeSize));
+}
+
+// Runs task(begin, end, range) over rangeCount equal ranges of [0, size)
+template <typename Task>
+inline void ParallelFor(std::size_t size, unsigned int rangeCount, Task task)
+{
+	RunParallel(rangeCount, [&](unsigned int range) {
+		task(size * range / rangeCount, size * (range + 1) / rangeCount, range);
+	});
+}
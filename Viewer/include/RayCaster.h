@@ -0,0 +1,25 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "CameraState.h"
+
+struct Ray
+{
+	glm::vec3 origin;
+	glm::vec3 direction;	// not normalized
+};
+
+/*
+ * RayCaster class.
+ * Turns a point of the viewport into the world space ray through it, for picking. The ray starts on
+ * the near plane and reaches the far plane at t = 1, so it works the same for both projections, and
+ * a hit's t orders hits like depth does.
+ */
+class RayCaster
+{
+public:
+	// cursor in pixels from the top left corner of a viewport of viewportSize pixels
+	static Ray FromCursor(const CameraState& camera, const glm::vec2& cursor, const glm::vec2& viewportSize);
+
+	// The same ray in the space that transform maps to world space, t is unchanged
+	static Ray ToLocal(const Ray& ray, const glm::mat4& transform);
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "MeshModel.h"
+
+// PASS_OCCLUSION draws the bounding boxes of a filled batch's instances, invisibly, inside an occlusion
+// query; Renderer adds those batches itself, they are never queued
+enum RenderPass { PASS_FILL, PASS_WIRE, PASS_BOX, PASS_NORMALS, PASS_OCCLUSION };
+
+/*
+ * RenderQueue class.
+ * The draws of one frame, one item per model and pass, sorted by a 64 bit key so that draws sharing
+ * GL state end up next to each other. From the most significant bits down the key holds:
+ *	pass (3 bits) | program (5) | texture (14) | material (12) | geometry (14) | level of detail (3) | depth (13)
+ * GL names and the material are truncated / hashed into their fields, so the key only orders the
+ * draws: Renderer compares the real state before skipping a change. The material is above the
+ * geometry: meshes share a few VAOs through GeometryBuffer, so consecutive meshes of one material can
+ * go in one multi-draw; the geometry field then keeps the meshes of one VAO, and each mesh's draws,
+ * together.
+ */
+class RenderQueue
+{
+public:
+	struct Item
+	{
+		std::uint64_t key;
+		RenderPass pass;
+		const MeshModel* model;
+		glm::mat4 transform;
+	};
+
+private:
+	struct SortEntry
+	{
+		std::uint64_t key;
+		std::uint32_t index;
+	};
+
+	std::vector<Item> items;
+	std::vector<SortEntry> order;
+
+	static std::uint32_t GetMaterialId(const MeshModel& model);
+	static std::uint64_t GetDepthBits(float depth);
+
+public:
+	// The VAO of a pass drawing the model's helper lines, 0 for its triangles: those are in GeometryBuffer
+	static GLuint GetVAO(const MeshModel& model, RenderPass pass);
+	static std::uint32_t GetGeometryId(const MeshModel& model, RenderPass pass);
+	static std::uint64_t MakeKey(RenderPass pass, GLuint program, GLuint texture, std::uint32_t material, std::uint32_t geometry, int lod, float depth);
+
+	void Clear();
+
+	// depth is the model's distance in front of the camera, nearer draws sort first within their state
+	void Add(RenderPass pass, const MeshModel* model, const glm::mat4& transform, float depth, GLuint program);
+	void Sort();
+
+	std::size_t GetCount() const;
+	const Item& GetSorted(std::size_t i) const;
+};
@@ -2,8 +2,18 @@
 #include "Scene.h"
 #include "ShaderProgram.h"
 #include "Texture2D.h"
+#include "GLHandle.h"
+#include "RenderQueue.h"
+#include "Frustum.h"
+#include "SceneBVH.h"
+#include "RayCaster.h"
+#include "UniformBlocks.h"
+#include "StreamBuffer.h"
+#include "GeometryBuffer.h"
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <GLFW/glfw3.h>
@@ -11,12 +21,100 @@
 
 typedef glm::vec3 vec3;
 
+// How the draws of the models' own triangles, all in GeometryBuffer, are submitted: SUBMIT_LOOP binds
+// a VAO per mesh, the other two the shared VAOs, with one draw call per batch or one per run of batches
+enum SubmitMode { SUBMIT_LOOP, SUBMIT_BASE_VERTEX, SUBMIT_MULTI_DRAW };
+
 /*
  * Renderer class.
+ * Draws the scene every frame: culls the models, cameras and lights against the active camera's
+ * frustum through a SceneBVH, sorts what is left in a RenderQueue and draws it as instanced batches,
+ * with the per frame data in a StreamBuffer and the mesh triangles in a GeometryBuffer.
  */
 class Renderer
 {
 private:
+	struct InstanceData
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+	};
+
+	struct Batch
+	{
+		RenderPass pass;
+		const MeshModel* model;	// the first model of the batch, the others match its mesh and material
+		std::size_t first;
+		std::size_t count;
+		std::size_t object;		// its ObjectData block in objectBlocks
+		GLuint query;			// PASS_OCCLUSION: the query to issue. PASS_FILL: the one to draw on, 0 for always
+		const GeometryBuffer::Allocation* geometry;	// the mesh in sharedGeometry, nullptr for the helper lines
+		std::uint64_t members;	// PASS_FILL: a hash of its models, 0 if one of them is too close for a query
+	};
+
+	// the layout glMultiDrawElementsIndirect reads
+	struct DrawCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	struct OcclusionQuery
+	{
+		GLQuery query;
+		std::uint64_t members;	// of the run it was issued for last frame, the only one its result stands for
+		int frame;				// the last frame it was issued in
+	};
+
+	struct Candidate
+	{
+		MeshModel* model;
+		glm::mat4 transform;
+	};
+
+	static const GLuint InstanceModelLocation = 3;
+	static const GLuint InstanceColorLocation = 7;
+
+	// rebuilt every frame, kept around so their memory is too
+	std::vector<Candidate> candidates;
+	std::vector<AABB> candidateBoxes;		// one per candidate, in world space
+	std::vector<std::uint32_t> visibleCandidates;
+	Frustum frustum;
+	RenderQueue renderQueue;
+	std::vector<InstanceData> instances;
+	std::vector<Batch> batches;
+	std::vector<unsigned char> objectBlocks;	// ObjectData blocks, one streamBuffer alignment apart
+	std::size_t objectCount;
+	StreamBuffer streamBuffer;
+	FrameData frameData;			// bound by SubmitBatches, with the blocks written there
+	std::size_t instancesOffset;	// of the frame's instances in streamBuffer
+	GeometryBuffer sharedGeometry;
+	std::vector<DrawCommand> commands;
+	bool multiDrawSupported;
+	double submitMs[3];		// per SubmitMode, averaged over the frames drawn in it
+	int drawCalls;
+	int stateChanges;
+	int visibleCount;
+	int culledCount;
+
+	// over candidateBoxes, the candidates it was built for are bvhModels
+	SceneBVH sceneBVH;
+	std::vector<const MeshModel*> bvhModels;
+	int bvhRebuilds;
+
+	// one query per run of fill batches drawn together, by the run's first model; dropped the first
+	// frame no run gets it
+	std::unordered_map<const MeshModel*, OcclusionQuery> occlusionQueries;
+	std::unordered_set<const MeshModel*> closeModels;	// a box the near plane could cut, never queried
+	GLenum occlusionTarget;
+	int frameIndex;
+	int conditionalDraws;
+	int occludedDraws;
+	int triangleCount;
+
 	int viewportWidth;
 	int viewportHeight;
 	int viewportX;
@@ -42,17 +140,64 @@ private:
 
 	glm::vec3 centerAxes;
 
+	// The ObjectData block for a batch of pass, reusing the last one if it is the same
+	std::size_t AddObjectData(RenderPass pass, const MeshModel& model);
+	// Whether next is drawn by the same glMultiDrawElementsIndirect as batch, if it follows it
+	bool JoinsMultiDraw(const Batch& batch, const Batch& next) const;
+	void AddOcclusionBatches();
+
 public:
 	bool alias;
 	bool fogActivated;
 	glm::vec3 fogColor;
+	bool frustumCulling;
+	bool occlusionCulling;
+	bool levelOfDetail;
+	SubmitMode submitMode;	// SUBMIT_MULTI_DRAW falls back to SUBMIT_BASE_VERTEX where unsupported
 
 	Renderer();
 	~Renderer();
 
-	void DrawModel(const Scene & scene, MeshModel* model);
+	// Adds a model and its world space box to the frame's culling candidates
+	void CollectModel(const Scene& scene, MeshModel* model);
+	void UpdateSceneBVH();
+	void QueueModel(const glm::mat4& view, MeshModel* model, const glm::mat4& transform);
+	void BuildBatches();
+	void SubmitBatches();
+
+	// With a model's VAO bound: instance attributes from the frame's instances, starting at first
+	void BindInstances(std::size_t first);
 
 	void Render(const Scene& scene);
+	int GetDrawCallCount() const;
+	int GetStateChangeCount() const;
+	int GetVisibleCount() const;
+	int GetCulledCount() const;
+
+	// Draws made under a conditional render, and those of them the GPU skipped; a skipped draw only
+	// counts once its query result is available, which is read without waiting for it
+	int GetConditionalDrawCount() const;
+	int GetOccludedDrawCount() const;
+
+	// Filled triangles drawn, at the levels of detail used
+	int GetTriangleCount() const;
+
+	bool IsSubmitModeSupported(SubmitMode mode) const;
+	// CPU milliseconds SubmitBatches took in mode, 0 if no frame was drawn in it yet
+	double GetSubmitMs(SubmitMode mode) const;
+	const GeometryBuffer& GetSharedGeometry() const;
+
+	// Where the per frame data goes; it moves on to its next region every Render
+	const StreamBuffer& GetStreamBuffer() const;
+
+	// Object i of the hierarchy is GetSceneObject(i); both are as of the last Render
+	const SceneBVH& GetSceneBVH() const;
+	MeshModel* GetSceneObject(std::uint32_t object) const;
+	int GetBVHRebuildCount() const;
+
+	// The model whose triangles the ray hits first, of those drawn by the last Render (nullptr if none),
+	// found through the scene BVH and then each model's MeshBVH. distance is the hit's t along the ray
+	MeshModel* Pick(const Ray& ray, float& distance) const;
 
 	void LoadShaders();
 	/*glm::vec3 centerPoint(glm::vec3 point);
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "MeshResource.h"
+#include "Texture2D.h"
+
+/*
+ * ResourceManager class.
+ * Interns meshes and textures, so each is resident on the GPU once however many models use it.
+ * A resource is found by its file first (canonical path, size and write time, so edited files load
+ * again), and then by a hash of its content, which also catches copies of a file under another name.
+ * Only weak references are kept: a resource is freed together with the last model using it.
+ * Main (GL) thread only, apart from the static hashing helpers.
+ */
+class ResourceManager
+{
+public:
+	struct ResidentResource
+	{
+		std::string name;
+		std::size_t size;	// bytes on the GPU
+		long users;
+	};
+
+private:
+	template <typename Resource>
+	struct Table
+	{
+		struct Entry
+		{
+			std::string name;
+			std::weak_ptr<Resource> resource;
+		};
+
+		std::unordered_map<std::uint64_t, Entry> byHash;
+		std::unordered_map<std::string, std::uint64_t> byFile;
+
+		std::shared_ptr<Resource> Find(std::uint64_t hash) const;
+		std::shared_ptr<Resource> Find(const std::string& fileKey) const;
+		std::shared_ptr<Resource> Add(const std::string& fileKey, std::uint64_t hash, const std::string& name, const std::shared_ptr<Resource>& resource);
+		void Prune();
+	};
+
+	Table<MeshResource> meshes;
+	Table<Texture2D> textures;
+
+public:
+	// The key files are interned by, empty if filePath can't be read
+	static std::string GetFileKey(const std::string& filePath);
+
+	static std::uint64_t HashContent(const void* data, std::size_t size, std::uint64_t hash = 14695981039346656037ull);
+	static std::uint64_t HashMeshData(const MeshData& data);
+
+	// Blocking load through the tables, for the meshes the viewer ships with (see Camera and Light);
+	// they get no levels of detail, so a cache miss only costs the parsing
+	std::shared_ptr<MeshResource> LoadMesh(const std::string& filePath);
+
+	std::shared_ptr<MeshResource> FindMesh(const std::string& fileKey) const;
+	std::shared_ptr<MeshResource> FindMesh(std::uint64_t hash) const;
+	std::shared_ptr<Texture2D> FindTexture(const std::string& fileKey) const;
+	std::shared_ptr<Texture2D> FindTexture(std::uint64_t hash) const;
+
+	// Interns a resource. If one with the same content is already resident, that one is returned instead.
+	std::shared_ptr<MeshResource> AddMesh(const std::string& fileKey, std::uint64_t hash, const std::string& name, const std::shared_ptr<MeshResource>& mesh);
+	std::shared_ptr<Texture2D> AddTexture(const std::string& fileKey, std::uint64_t hash, const std::string& name, const std::shared_ptr<Texture2D>& texture);
+
+	// What is resident right now; also forgets resources nobody uses anymore
+	std::vector<ResidentResource> GetResidentMeshes();
+	std::vector<ResidentResource> GetResidentTextures();
+};
@@ -53,15 +53,16 @@ public:
 	const int GetActiveModelIndex() const;
 
 	// Add more methods as needed...
-	std::vector<std::shared_ptr<MeshModel>> GetModels() const;
-	std::vector<Camera*> GetCameras() const;
-	std::vector<Light*> GetLights() const;
+	const std::vector<std::shared_ptr<MeshModel>>& GetModels() const;
+	const std::vector<Camera*>& GetCameras() const;
+	const std::vector<Light*>& GetLights() const;
 	const MeshModel & GetModel(int index) const;
 	const Camera & GetCamera(int index) const;
 	const Light & GetLight(int index) const;
 	const MeshModel& GetActiveModel() const;
 
 	Camera& GetActiveCamera() const;
+	const CameraState& GetActiveCameraState() const;
 
 	void SetWorldTransformation();
 	glm::mat4 GetWorldTransformation() const;
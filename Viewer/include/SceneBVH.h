@@ -0,0 +1,88 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include "AABB.h"
+#include "Frustum.h"
+
+/*
+ * SceneBVH class.
+ * A bounding volume hierarchy over the world space boxes of scene objects, which it knows only
+ * by index. Built top down, splitting where the surface area heuristic (SAH) over a few bins
+ * of object centers says it is cheapest. Objects that move get their new boxes with SetBox,
+ * and Refit grows or shrinks only the nodes above them. Refitting slowly makes the tree worse,
+ * so NeedsRebuild tells when its SAH cost has drifted too far from the fresh build.
+ */
+class SceneBVH
+{
+public:
+	struct Node
+	{
+		AABB box;
+		std::uint32_t left;		// the children are left and left + 1; 0 for a leaf
+		std::uint32_t parent;
+		std::uint32_t first;	// objects in objectIndices[first, first + count), for inner nodes too
+		std::uint32_t count;
+	};
+
+	static const std::uint32_t NoObject = 0xffffffffu;
+	static const int BinCount = 12;
+	static const std::uint32_t MaxLeafSize = 4;
+
+private:
+	// What Build partitions: one per object, kept together so the passes over them read memory in order
+	struct BuildItem
+	{
+		AABB box;
+		glm::vec3 center;
+		std::uint32_t object;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<std::uint32_t> objectIndices;	// objects ordered by leaf
+	std::vector<AABB> objectBoxes;
+	std::vector<std::uint32_t> objectLeaves;	// the leaf holding each object
+	std::vector<std::uint32_t> dirtyLeaves;
+	std::vector<unsigned char> leafDirty;
+	float builtCost;
+	int depth;
+
+	void Split(std::uint32_t nodeIndex, std::vector<BuildItem>& items);
+	AABB GetObjectsBox(std::uint32_t first, std::uint32_t count) const;
+
+public:
+	SceneBVH();
+
+	void Build(const std::vector<AABB>& boxes);
+	void Clear();
+
+	// Changes an object's box; the tree catches up on Refit. Same box: nothing to do
+	void SetBox(std::uint32_t object, const AABB& box);
+	const AABB& GetBox(std::uint32_t object) const;
+
+	// Refits the nodes above every object moved since the last refit. Returns how many changed
+	std::size_t Refit();
+
+	// True once refitting has made the tree twice as expensive to traverse as when it was built
+	bool NeedsRebuild() const;
+
+	// Appends the objects whose boxes are at least partly inside frustum / overlap box
+	void QueryFrustum(const Frustum& frustum, std::vector<std::uint32_t>& objects) const;
+	void QueryBox(const AABB& box, std::vector<std::uint32_t>& objects) const;
+
+	// The object whose box the ray origin + t * direction enters first, for t in [0, maxDistance].
+	// NoObject if none; distance is where the ray enters that box. With a hitTest, an object only counts
+	// if hitTest(object, distance) says the ray really hits it, closer than distance, which it then lowers
+	std::uint32_t Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance,
+		const std::function<bool(std::uint32_t, float&)>& hitTest = nullptr) const;
+
+	// The expected cost of a query, relative to testing one box
+	float GetCost() const;
+
+	std::size_t GetObjectCount() const;
+	std::size_t GetNodeCount() const;
+	int GetDepth() const;
+	const std::vector<Node>& GetNodes() const;
+};
@@ -3,10 +3,20 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "GLHandle.h"
+#include "ShaderUniforms.h"
 using std::string;
 
+/*
+ * ShaderProgram class.
+ * Links a vertex and a fragment shader, then reflects the program's active uniforms with
+ * glGetActiveUniform: their locations and types are looked up once there, never while drawing.
+ * Uniforms are set either by UniformId, an index into a table resolved at link time, or by name.
+ * Debug builds check that the value set matches the type the GLSL declares.
+ */
 
 class ShaderProgram
 {
@@ -14,6 +24,11 @@ public:
 	ShaderProgram();
 	~ShaderProgram();
 
+	ShaderProgram(const ShaderProgram& other) = delete;
+	ShaderProgram& operator=(const ShaderProgram& other) = delete;
+	ShaderProgram(ShaderProgram&& other) = default;
+	ShaderProgram& operator=(ShaderProgram&& other) = default;
+
 	enum ShaderType
 	{
 		VERTEX,
@@ -36,16 +51,42 @@ public:
 	void setUniform(const GLchar* name, const GLint v);
 	void setUniformSampler(const GLchar* name, const GLint& slot);
 
-	// We are going to speed up looking for uniforms by keeping their locations in a map
-	GLint getUniformLocation(const GLchar * name);
+	void setUniform(UniformId id, const glm::vec2& v);
+	void setUniform(UniformId id, const glm::vec3& v);
+	void setUniform(UniformId id, const glm::vec4& v);
+	void setUniform(UniformId id, const glm::vec3* v);
+	void setUniform(UniformId id, const glm::vec4* v);
+	void setUniform(UniformId id, const glm::mat4& m);
+	void setUniform(UniformId id, const GLfloat f);
+	void setUniform(UniformId id, const GLint v);
+	void setUniformSampler(UniformId id, const GLint& slot);
+
+	// Connects a uniform block to a binding point, where a buffer range is bound with glBindBufferRange
+	bool bindUniformBlock(const GLchar* name, GLuint binding);
+
+	// -1 if the program has no such active uniform
+	GLint getUniformLocation(const GLchar * name) const;
+	GLint getUniformLocation(UniformId id) const;
 
 private:
+	struct UniformHandle
+	{
+		GLint location;		// -1 if not active in this program
+		GLenum type;		// as declared in the GLSL, e.g. GL_FLOAT_VEC3
+		GLint size;			// array length, 1 if not an array
+	};
 
 	string fileToString(const string& filename) const;
 	void  checkCompileErrors(GLuint shader, ShaderType type) const;
+	void reflectUniforms();
 
+	// The handle of an active uniform that takes a value of the given type, or NULL
+	const UniformHandle* getHandle(const GLchar* name, GLenum type) const;
+	const UniformHandle* getHandle(UniformId id, GLenum type) const;
+	static bool checkType(const UniformHandle& handle, GLenum type, const GLchar* name);
 
-	GLuint programHandle;
-	std::map<string, GLint> uniformLocations;
+	GLProgram programHandle;
+	std::map<string, UniformHandle> uniformsByName;
+	std::vector<UniformHandle> uniformHandles;	// indexed by UniformId
 };
 #endif // SHADER_H
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+/*
+ * Uniform identifiers.
+ * The uniforms of the default block that C++ sets, one id each. ShaderProgram resolves all of them
+ * once, when the program links, so setting one by id is an array index. Add a new uniform to the
+ * enum and to UniformNames, in the same order, under the name the GLSL declares it with.
+ * Uniforms inside blocks are not listed here, see UniformBlocks.h.
+ */
+enum UniformId
+{
+	UNIFORM_TEXTURE_MAP,
+	UNIFORM_COUNT
+};
+
+static const char* const UniformNames[UNIFORM_COUNT] =
+{
+	"textureMap"
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+#include "GLHandle.h"
+
+/*
+ * StreamBuffer class.
+ * One buffer for everything written anew every frame: uniform blocks, instance attributes and indirect
+ * draw commands. It is split in RegionCount regions, each frame sub-allocates from the next one, front
+ * to back, so a write never lands on bytes the GPU may still be reading for one of the frames before.
+ * With GL 4.4 or ARB_buffer_storage the buffer is mapped once, persistent and coherent, and a write is
+ * a memcpy. A fence after each frame guards its region: the frame that comes back to it waits on the
+ * fence, which only happens when the GPU is more than two frames behind. Without it writes are
+ * glBufferSubData, and the buffer is orphaned (respecified with glBufferData) every time the first
+ * region comes around, the driver keeps the old storage for the draws still reading it.
+ * A frame that writes more than a region holds moves to a buffer with bigger regions.
+ */
+class StreamBuffer
+{
+private:
+	static const int RegionCount = 3;
+
+	GLBuffer buffer;
+	std::vector<GLBuffer> retired;	// replaced this frame, bindings made before still name them
+	unsigned char* mapped;			// the whole buffer, when persistent
+	bool persistent;
+	std::size_t regionSize;
+	std::size_t alignment;
+	int region;
+	std::size_t head;
+	GLsync fences[RegionCount];
+	int waits;
+
+	void CreateStorage();
+	void DeleteFences();
+
+public:
+	StreamBuffer();
+	~StreamBuffer();
+
+	StreamBuffer(const StreamBuffer& other) = delete;
+	StreamBuffer& operator=(const StreamBuffer& other) = delete;
+
+	// Needs the context: queries GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT and buffer storage support
+	void Create(std::size_t regionSize);
+
+	// Ends the frame's region and starts the next one, waiting for the GPU if it still reads it.
+	// Once a frame, before its first write
+	void NextFrame();
+
+	// size rounded up to the offset alignment: the stride of blocks written together
+	std::size_t Align(std::size_t size) const;
+
+	// Makes sure the next writes of size bytes in total, each one aligned, stay in the current buffer.
+	// A write that doesn't fit moves everything after it to a new buffer, so blocks whose offsets are
+	// used together are reserved together first
+	void Reserve(std::size_t size);
+
+	// Copies size bytes to the buffer and returns their offset, aligned for a uniform block
+	std::size_t Write(const void* data, std::size_t size);
+
+	// Binds size bytes at offset to a uniform binding point
+	void Bind(GLuint binding, std::size_t offset, std::size_t size) const;
+
+	GLuint GetBuffer() const;
+	std::size_t GetCapacity() const;
+	bool IsPersistent() const;
+
+	// Frames that found their region still in use by the GPU and waited for it
+	int GetWaitCount() const;
+};
@@ -4,6 +4,7 @@
 #include <glad/glad.h>
 #include <string>
 #include <algorithm>
+#include "GLHandle.h"
 
 using std::string;
 
@@ -18,16 +19,32 @@ class Texture2D
 public:
 	Texture2D();
 	virtual ~Texture2D();
-	Texture2D(const Texture2D& rhs) {}
-	Texture2D& operator = (const Texture2D& rhs) {}
+	Texture2D(const Texture2D& rhs) = delete;
+	Texture2D& operator = (const Texture2D& rhs) = delete;
+	Texture2D(Texture2D&& rhs) = default;
+	Texture2D& operator = (Texture2D&& rhs) = default;
 
 	bool loadTexture(const string& fileName, bool generateMipMaps = true);
+
+	// Replaces the texture with width x height RGBA pixels. With a GL_PIXEL_UNPACK_BUFFER bound,
+	// pixels is an offset into that buffer instead (see TextureLoader).
+	bool createTexture(int width, int height, const void* pixels, bool generateMipMaps = true);
+
+	// Copies RGBA rows from src to dst bottom up: stb images start at the top row, GL textures at the bottom one
+	static void copyFlipped(const unsigned char* src, unsigned char* dst, int width, int height);
 	void bind(GLuint texUnit = 0) const;
 	void unbind(GLuint texUnit = 0) const;
 
 	bool generateBombingTexture(bool generateMipMaps);
 
+	// bytes the texture takes on the GPU, mip maps included
+	std::size_t getMemorySize() const;
+	GLuint getHandle() const;
+
 private:
-	GLuint mTexture;
+	GLTexture mTexture;
+	int mWidth;
+	int mHeight;
+	bool mMipMaps;
 };
 #endif
@@ -0,0 +1,65 @@
+#pragma once
+#include <glad/glad.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "MeshModel.h"
+#include "WorkerPool.h"
+
+class ResourceManager;
+
+/*
+ * TextureLoader class.
+ * Loads textures onto models without stalling the render loop. A texture goes through three steps:
+ *	1. a worker decodes the file (stb_image)
+ *	2. Poll() maps a pixel buffer object for it, and a worker copies the image into it flipped
+ *	3. Poll() unmaps the buffer and creates the texture from it, so the transfer runs on the GPU's time
+ * Textures whose model was removed in the meantime are dropped, and ones whose pixels are already
+ * resident (see ResourceManager) are shared instead of uploaded again.
+ */
+class TextureLoader
+{
+private:
+	struct PendingTexture
+	{
+		std::weak_ptr<MeshModel> model;
+		std::string fileName;
+		std::string fileKey;
+		std::uint64_t hash;
+		bool generateMipMaps;
+		int width;
+		int height;
+		unsigned char* pixels;
+		GLuint pixelBuffer;
+		void* mappedPixels;
+	};
+
+	ResourceManager& resources;
+	std::mutex mutex;
+	std::vector<std::shared_ptr<PendingTexture>> decoded;
+	std::vector<std::shared_ptr<PendingTexture>> staged;
+	std::atomic<int> loading;
+	WorkerPool pool;
+
+	void Decode(std::shared_ptr<PendingTexture> texture);
+	void Stage(std::shared_ptr<PendingTexture> texture);
+	void Upload(PendingTexture& texture, const void* pixels);
+	void Finish(PendingTexture& texture);
+
+public:
+	explicit TextureLoader(ResourceManager& resources);
+	~TextureLoader();
+
+	TextureLoader(const TextureLoader& other) = delete;
+	TextureLoader& operator=(const TextureLoader& other) = delete;
+
+	// Textures already resident in resources are assigned to the model right away
+	void Load(const std::string& fileName, const std::shared_ptr<MeshModel>& model, bool generateMipMaps = true);
+	bool IsLoading() const;
+
+	// Main (GL) thread only: moves textures on to their next step
+	void Poll();
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+/*
+ * Uniform block layouts.
+ * The std140 uniform blocks of vshader.glsl and fshader.glsl, as C++ structs. Every member is a whole
+ * number of vec4s, or padded to one, so the structs have the same layout as the blocks and are copied
+ * into uniform buffers as they are.
+ */
+
+// Binding points, set on the program with ShaderProgram::bindUniformBlock
+static const GLuint FrameDataBinding = 0;
+static const GLuint ObjectDataBinding = 1;
+
+// Written once per frame
+struct FrameData
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec4 lightColors[5];
+	glm::vec4 lightLocations[5];
+};
+
+// Written once per batch: the material and vertex format shared by all of its instances
+struct ObjectData
+{
+	glm::vec4 positionMin;		// xyz, for compact vertices
+	glm::vec4 positionExtent;	// xyz, for compact vertices
+	GLfloat Ka;
+	GLfloat Kd;
+	GLfloat Ks;
+	GLint alpha;
+	GLint useTexture;
+	GLint compactVertices;
+	GLint textureProjection;	// a Proj, see MeshModel.h
+	GLint padding;
+};
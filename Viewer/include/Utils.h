@@ -1,9 +1,21 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <string>
+#include <memory>
 #include "MeshModel.h"
 #include "Scene.h"
+#include "LoadProgress.h"
 
+/*
+ * MeshBounds struct.
+ * The axis aligned bounding box and the centroid of a vertex array.
+ */
+struct MeshBounds
+{
+	glm::vec4 mins;
+	glm::vec4 maxs;
+	glm::vec3 avg;
+};
 
 /*
  * Utils class.
@@ -11,10 +23,25 @@
  */
 class Utils
 {
+private:
+	// the fewest vertices / faces worth a thread of their own in CalculateNormals
+	static constexpr std::size_t MinNormalRange = 16 * 1024;
+
 public:
 	static glm::vec3 Vec3fFromStream(std::istream& issLine);
 	static glm::vec2 Vec2fFromStream(std::istream& issLine);
-	static MeshModel LoadMeshModel(const std::string& filePath);
+	static std::shared_ptr<MeshModel> LoadMeshModel(const std::string& filePath);
+
+	// The CPU half of LoadMeshModel. The first overload is for the meshes the viewer ships with
+	// (see Camera and Light) and builds no levels of detail, the second is safe to call from a worker thread.
+	// optimize runs MeshOptimizer on the model buffers (once, the cache keeps the result apart from
+	// the unoptimized one, see MeshCache). buildLods, on by default, runs MeshSimplifier unless the
+	// cache already has the levels. Both write the .meshbin cache next to the file.
+	static MeshData LoadMeshData(const std::string& filePath);
+	static bool LoadMeshData(const std::string& filePath, MeshData& data, LoadProgress* progress = nullptr, bool optimize = false, bool buildLods = true);
+	// Parses the file into the welded model buffers in its own order, without reading or writing the cache
+	static bool ParseMeshData(const std::string& filePath, MeshData& data, LoadProgress* progress = nullptr);
+	static void WeldVertices(MeshData& data);
 
 	// Add here more static utility functions...
 	// For example:
@@ -42,13 +69,17 @@ public:
 	static glm::vec3 Mult(glm::mat4& mat, glm::vec3& point);
 	static glm::vec3 Mult(glm::mat4& mat, glm::vec4& point);
 
-	static std::vector<glm::vec3> FaceToVertices(const Face& face, const std::vector<glm::vec3>& vertices);
 	static glm::vec3 GetMarbleColor(float x, glm::vec3 c1, glm::vec3 c2);
-	static std::vector<glm::vec3> FaceToNormals(const Face& face, const std::vector<glm::vec3>& normals);
 
 	static glm::vec4 GenerateRandomColor();
-	static std::vector<glm::vec3> CalculateNormals(std::vector<glm::vec3> vertices, std::vector<Face> faces);
 
-private:
+	// Area weighted vertex normals of the triangles in indices (three per triangle), plus the bounds of vertices.
+	// normals needs room for vertexCount entries; pass nullptr (and no indices) to only compute the bounds.
+	// threadCount == 0 uses all hardware threads.
+	static void CalculateNormals(const glm::vec3* vertices, std::size_t vertexCount, const std::uint32_t* indices, std::size_t indexCount, glm::vec3* normals, MeshBounds& bounds, unsigned int threadCount = 0);
+
+	// Whether every corner of mesh has a normal from the file (normalCount is how many the file had)
+	static bool HasFileNormals(const IndexedMesh& mesh, std::size_t normalCount);
+
 	static std::string GetFileName(const std::string& filePath);
 };
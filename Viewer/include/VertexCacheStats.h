@@ -0,0 +1,13 @@
+#pragma once
+
+/*
+ * VertexCacheStats struct.
+ * How well an index buffer uses the post-transform vertex cache, measured by simulating a FIFO cache.
+ * ACMR: vertex shader runs per triangle (0.5 is the ideal for large regular meshes, 3 the worst).
+ * ATVR: vertex shader runs per unique vertex (1 is the ideal).
+ */
+struct VertexCacheStats
+{
+	float acmr = 0.0f;
+	float atvr = 0.0f;
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "MeshModel.h"
+
+/*
+ * VertexQuantizer class.
+ * Packs Vertex (32 bytes) into CompactVertex (16 bytes) for the GPU. vshader.glsl undoes it:
+ * positions are 16 bit fractions of the model's bounding box, normals are octahedral encoded
+ * into two 16 bit snorms, and texture coordinates are half floats.
+ */
+class VertexQuantizer
+{
+public:
+	static void Quantize(const std::vector<Vertex>& vertices, const glm::vec3& mins, const glm::vec3& maxs, std::vector<CompactVertex>& compactVertices);
+	static CompactVertex Quantize(const Vertex& vertex, const glm::vec3& mins, const glm::vec3& scale);
+
+	// The box size vshader.glsl scales positions back up by; never zero, even for flat models
+	static glm::vec3 GetExtent(const glm::vec3& mins, const glm::vec3& maxs);
+
+	static glm::vec2 OctahedralEncode(const glm::vec3& normal);
+	static std::uint16_t FloatToHalf(float value);
+};
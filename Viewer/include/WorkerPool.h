@@ -0,0 +1,39 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * WorkerPool class.
+ * A fixed set of threads running submitted tasks in FIFO order. Tasks must not touch GL;
+ * they hand their results back to the main thread themselves (see TextureLoader).
+ */
+class WorkerPool
+{
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<std::function<void()>> tasks;
+	bool stopping;
+
+	void Run();
+
+public:
+	// threadCount 0 leaves one hardware thread to the render loop (but always starts at least one)
+	explicit WorkerPool(unsigned int threadCount = 0);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool& other) = delete;
+	WorkerPool& operator=(const WorkerPool& other) = delete;
+
+	void Submit(std::function<void()> task);
+
+	// Runs the tasks already queued, then joins the threads. Submit must not be called afterwards.
+	void Stop();
+
+	unsigned int GetThreadCount() const;
+};
@@ -1,41 +1,54 @@
 #version 330 core
 
-struct Material
+// std140 blocks, the same in both shaders, see UniformBlocks.h.
+// FrameData is written once per frame, ObjectData once per batch of instances.
+layout(std140) uniform FrameData
 {
-	sampler2D textureMap;
-	vec4 color;
+	mat4 view;
+	mat4 projection;
+	vec4 lightColors[5];
+	vec4 lightLocations[5];
+};
 
+// compactVertices is set for models drawn from CompactVertex buffers: pos is then a
+// fraction of the positionMin + positionExtent box and normal.xy an octahedral encoded normal.
+// textureProjection is only read by the vertex shader
+layout(std140) uniform ObjectData
+{
+	vec4 positionMin;		// xyz
+	vec4 positionExtent;	// xyz
 	float Ka;
 	float Kd;
 	float Ks;
 	int alpha;
+	bool useTexture;
+	bool compactVertices;
+	int textureProjection;
 };
 
-uniform Material material;
-uniform vec4 lightLocations[5];
-uniform vec4 lightColors[5];
-uniform bool useTexture;
+uniform sampler2D textureMap;
 
 in vec4 fragPos;
 in vec4 fragNormal;
 in vec2 fragTexCoords;
+flat in vec4 fragMaterialColor;
 
 out vec4 fragColor;
 
 void main()
 {
 	// Sample the texture-map at the UV coordinates given by 'fragTexCoords'
-	vec4 materialColor = material.color;
+	vec4 materialColor = fragMaterialColor;
 
 	if (useTexture) {
-		vec3 textureColor = vec3(texture(material.textureMap, fragTexCoords));
+		vec3 textureColor = vec3(texture(textureMap, fragTexCoords));
 		materialColor = vec4(textureColor, 1.0f);
 	}
 
 	vec3 N = normalize(fragNormal.xyz / fragNormal.w);
 	vec3 V = normalize(fragPos.xyz / fragPos.w);
 
-	vec4 IA = material.Ka * materialColor;
+	vec4 IA = Ka * materialColor;
 	vec4 ID = vec4(0.0f);
 	vec4 IS = vec4(0.0f);
 
@@ -46,12 +59,12 @@ void main()
 		vec3 L = normalize(lightLocation - (fragPos.xyz / fragPos.w));
 		vec3 R = normalize(reflect(-L, N));
 		float diff = max(dot(N, L), 0.0f);
-		float spec = pow(max(dot(R, V), 0.0f), material.alpha);
+		float spec = pow(max(dot(R, V), 0.0f), alpha);
 
-		vec4 diffuseColor = material.Kd * diff * lightColor;
+		vec4 diffuseColor = Kd * diff * lightColor;
 		ID = ID + diffuseColor;
 
-		vec4 specularColor = material.Ks * spec * lightColor;
+		vec4 specularColor = Ks * spec * lightColor;
 		IS = IS + specularColor;
 	}
 
@@ -4,23 +4,82 @@ layout(location = 0) in vec3 pos;
 layout(location = 1) in vec3 normal;
 layout(location = 2) in vec2 texCoords;
 
-// The model/view/projection matrices
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Per instance: the model matrix (one column per location) and the material color.
+// Every draw is instanced, see Renderer.
+layout(location = 3) in mat4 instanceModel;
+layout(location = 7) in vec4 instanceColor;
+
+// std140 blocks, the same in both shaders, see UniformBlocks.h.
+// FrameData is written once per frame, ObjectData once per batch of instances.
+layout(std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	vec4 lightColors[5];
+	vec4 lightLocations[5];
+};
+
+// compactVertices is set for models drawn from CompactVertex buffers: pos is then a
+// fraction of the positionMin + positionExtent box and normal.xy an octahedral encoded normal.
+// textureProjection is a Proj of MeshModel.h, see ProjectTexture
+layout(std140) uniform ObjectData
+{
+	vec4 positionMin;		// xyz
+	vec4 positionExtent;	// xyz
+	float Ka;
+	float Kd;
+	float Ks;
+	int alpha;
+	bool useTexture;
+	bool compactVertices;
+	int textureProjection;
+};
 
 // These outputs will be available in the fragment shader as inputs
 out vec4 fragPos;
 out vec4 fragNormal;
 out vec2 fragTexCoords;
+flat out vec4 fragMaterialColor;
+
+vec3 OctahedralDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+// Texture coordinates from the model space position, for every projection but the original one
+vec2 ProjectTexture(vec3 position)
+{
+	const float PI = 3.14159265359f;
+	if (textureProjection == 1) // planar
+		return position.xz;
+	if (textureProjection == 2) // spherical
+		return normalize(vec2(atan(position.x, position.y) / 2.0f * PI + 0.5f, 0.5f - asin(position.z) / PI));
+
+	// cylindrical
+	float theta = atan(position.z / position.x);
+	return 5.0f * vec2(cos(2.0f * PI * theta), sin(2.0f * PI * theta));
+}
 
 void main()
 {
-	mat4 MVP = projection * view * model;
+	mat4 MVP = projection * view * instanceModel;
+
+	vec3 position = pos;
+	vec3 vertexNormal = normal;
+	if (compactVertices)
+	{
+		position = positionMin.xyz + pos * positionExtent.xyz;
+		vertexNormal = OctahedralDecode(normal.xy);
+	}
 
-	fragPos = MVP * vec4(pos, 1.0f);
-	fragNormal = MVP * vec4(normal, 1.0f);
-	fragTexCoords = texCoords;
+	fragPos = MVP * vec4(position, 1.0f);
+	fragNormal = MVP * vec4(vertexNormal, 1.0f);
+	fragTexCoords = textureProjection == 0 ? texCoords : ProjectTexture(position);
+	fragMaterialColor = instanceColor;
 
-	gl_Position = MVP * vec4(pos, 1.0f);
+	gl_Position = MVP * vec4(position, 1.0f);
 }
\ No newline at end of file
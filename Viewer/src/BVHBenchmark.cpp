@@ -0,0 +1,129 @@
+#include "BVHBenchmark.h"
+#include "SceneBVH.h"
+#include "Frustum.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock BenchmarkClock;
+
+static double ElapsedMs(BenchmarkClock::time_point start, int runs)
+{
+	return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count() / runs;
+}
+
+BVHBenchmarkResult BVHBenchmark::Run(std::size_t objectCount, unsigned int seed)
+{
+	const int BuildRuns = 5;
+	const int RefitRuns = 10;
+	const int FrustumRuns = 100;
+	const int QueryCount = 1000;
+
+	std::mt19937 random(seed);
+	float sceneSize = 4.0f * std::cbrt((float)objectCount);
+	std::uniform_real_distribution<float> position(-0.5f * sceneSize, 0.5f * sceneSize);
+	std::uniform_real_distribution<float> size(0.25f, 2.0f);
+	std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<AABB> boxes(objectCount);
+	for (AABB& box : boxes)
+	{
+		glm::vec3 center(position(random), position(random), position(random));
+		glm::vec3 extent(size(random), size(random), size(random));
+		box = AABB(center - extent * 0.5f, center + extent * 0.5f);
+	}
+
+	BVHBenchmarkResult result;
+	result.objects = objectCount;
+
+	SceneBVH bvh;
+	BenchmarkClock::time_point start = BenchmarkClock::now();
+	for (int run = 0; run < BuildRuns; run++)
+	{
+		bvh.Build(boxes);
+	}
+	result.buildMs = ElapsedMs(start, BuildRuns);
+	result.nodes = bvh.GetNodeCount();
+	result.depth = bvh.GetDepth();
+
+	// move a tenth of the objects a little, like an animated scene would between frames
+	std::uniform_int_distribution<std::size_t> pick(0, objectCount > 0 ? objectCount - 1 : 0);
+	double refitTotal = 0.0;
+	for (int run = 0; run < RefitRuns && objectCount > 0; run++)
+	{
+		std::vector<std::uint32_t> moved(objectCount / 10 + 1);
+		for (std::uint32_t& object : moved)
+		{
+			object = (std::uint32_t)pick(random);
+		}
+
+		start = BenchmarkClock::now();
+		for (std::uint32_t object : moved)
+		{
+			AABB box = bvh.GetBox(object);
+			glm::vec3 delta(offset(random), offset(random), offset(random));
+			bvh.SetBox(object, AABB(box.mins + delta, box.maxs + delta));
+		}
+		bvh.Refit();
+		refitTotal += ElapsedMs(start, 1);
+	}
+	result.refitMs = refitTotal / RefitRuns;
+
+	// a camera in the middle of the scene that sees a quarter of the way through it, like a walk through
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, sceneSize * 0.25f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	Frustum frustum(projection * view);
+
+	std::vector<std::uint32_t> objects;
+	start = BenchmarkClock::now();
+	for (int run = 0; run < FrustumRuns; run++)
+	{
+		objects.clear();
+		bvh.QueryFrustum(frustum, objects);
+	}
+	result.frustumMs = ElapsedMs(start, FrustumRuns);
+	result.visible = objects.size();
+
+	BoxList boxList;
+	for (std::uint32_t object = 0; object < objectCount; object++)
+	{
+		boxList.Add(bvh.GetBox(object));
+	}
+	std::vector<unsigned char> visible;
+	start = BenchmarkClock::now();
+	for (int run = 0; run < FrustumRuns; run++)
+	{
+		frustum.Cull(boxList, visible);
+	}
+	result.linearCullMs = ElapsedMs(start, FrustumRuns);
+
+	std::vector<glm::vec3> origins(QueryCount);
+	std::vector<glm::vec3> directions(QueryCount);
+	for (int i = 0; i < QueryCount; i++)
+	{
+		origins[i] = glm::vec3(position(random), position(random), position(random));
+		directions[i] = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+	}
+	start = BenchmarkClock::now();
+	for (int i = 0; i < QueryCount; i++)
+	{
+		float distance;
+		bvh.Raycast(origins[i], directions[i], sceneSize, distance);
+	}
+	result.rayMs = ElapsedMs(start, 1);
+
+	start = BenchmarkClock::now();
+	for (int i = 0; i < QueryCount; i++)
+	{
+		objects.clear();
+		glm::vec3 extent(sceneSize * 0.02f);
+		bvh.QueryBox(AABB(origins[i] - extent, origins[i] + extent), objects);
+	}
+	result.boxMs = ElapsedMs(start, 1);
+
+	return result;
+}
@@ -2,16 +2,20 @@
 
 #include "Camera.h"
 #include "Utils.h"
+#include "ResourceManager.h"
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 
 #define PI 3.14159265358979323846 / 180
 
-Camera::Camera(const glm::vec3& eye, const glm::vec3& at, const glm::vec3& up) :
-	zoom(1.0), MeshModel(Utils::LoadMeshModel("..\\Data\\camera.obj")), projectionTransformation(glm::mat4(1)),
+static const char* CameraModelPath = "..\\Data\\camera.obj";
+
+Camera::Camera(ResourceManager& resources, const glm::vec3& eye, const glm::vec3& at, const glm::vec3& up) :
+	zoom(1.0), MeshModel(resources.LoadMesh(CameraModelPath), Utils::GetFileName(CameraModelPath)),
 	eye(eye), at(at), up(up), isOrth(1), fovy(45), height(2.5f), aspectRatio(1), n(0.1), f(100),
 	t(1.25f), b(-1.25f), l(-1.25f), r(1.25f), isAspect(true)
 {
+	state.projection = glm::mat4(1);
 	SetCameraLookAt(this->eye, this->at, this->up);
 	this->rotation = glm::vec3(0);
 	/*SetPerspectiveProjection(30, 1, 100, 1000);
@@ -34,13 +38,15 @@ void Camera::SetOrthographicProjection()
 void Camera::SetCameraLookAt(glm::vec3& eye, glm::vec3& at, glm::vec3& up)
 {
 	this->SetWorldTransformation();
-	this->viewTransformation = glm::lookAt(eye, at, up);
+	state.view = glm::lookAt(eye, at, up);
+	state.eye = eye;
 
 }
 
 void Camera::SetWorldTransformation(const glm::mat4x4& worldTransform)
 {
 	MeshModel::SetWorldTransformation(worldTransform);
+	state.world = worldTransform;
 }
 
 void Camera::SetWorldTransformation() {
@@ -62,7 +68,7 @@ void Camera::SetOrthographicProjection(
 		l = -0.5 * width;
 		r = 0.5 * width;
 	}
-	this->projectionTransformation = glm::ortho(l, r, b, t, _near, _far);
+	state.projection = glm::ortho(l, r, b, t, _near, _far);
 }
 
 void Camera::SetPerspectiveProjection() {
@@ -86,7 +92,7 @@ void Camera::SetPerspectiveProjection(
 		r = 0.5 * nearWidth;
 	}
 	
-	this->projectionTransformation = glm::perspective(fovy, _aspectRatio, _near, _far);
+	state.projection = glm::perspective(fovy, _aspectRatio, _near, _far);
 }
 
 void Camera::SetZoom(const float zoom)
@@ -101,11 +107,16 @@ void Camera::SetZoom(const float zoom)
 	}
 }
 
-glm::mat4 Camera::GetViewTransformation() const {
-	return this->viewTransformation;
+const glm::mat4& Camera::GetViewTransformation() const {
+	return state.view;
+}
+
+const glm::mat4& Camera::GetProjTransformation() const
+{
+	return state.projection;
 }
 
-glm::mat4 Camera::GetProjTransformation() const
+const CameraState& Camera::GetState() const
 {
-	return this->projectionTransformation;
+	return state;
 }
@@ -0,0 +1,164 @@
+#include "Frustum.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
+void BoxList::Clear()
+{
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+}
+
+void BoxList::Add(const AABB& box)
+{
+	glm::vec3 center = box.GetCenter();
+	glm::vec3 extent = box.GetExtent();
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	extentX.push_back(extent.x);
+	extentY.push_back(extent.y);
+	extentZ.push_back(extent.z);
+}
+
+std::size_t BoxList::GetCount() const
+{
+	return centerX.size();
+}
+
+Frustum::Frustum()
+{
+	for (int i = 0; i < 6; i++)
+	{
+		planes[i] = glm::vec4(0, 0, 0, 1);
+	}
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	Set(viewProjection);
+}
+
+void Frustum::Set(const glm::mat4& viewProjection)
+{
+	// a point is inside when -w <= x, y, z <= w in clip space; each side is a row of the matrix plus or minus the w row
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	planes[0] = rows[3] + rows[0];	// left
+	planes[1] = rows[3] - rows[0];	// right
+	planes[2] = rows[3] + rows[1];	// bottom
+	planes[3] = rows[3] - rows[1];	// top
+	planes[4] = rows[3] + rows[2];	// near
+	planes[5] = rows[3] - rows[2];	// far
+
+	for (int i = 0; i < 6; i++)
+	{
+		float length = glm::length(glm::vec3(planes[i]));
+		if (length > 0.0f)
+			planes[i] /= length;
+	}
+}
+
+const glm::vec4& Frustum::GetPlane(int index) const
+{
+	return planes[index];
+}
+
+bool Frustum::IsVisible(const glm::vec3& center, const glm::vec3& extent) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		glm::vec3 normal(planes[i]);
+		float distance = glm::dot(normal, center) + planes[i].w;
+		float radius = glm::dot(glm::abs(normal), extent);
+		if (distance + radius < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+FrustumTest Frustum::Classify(const AABB& box) const
+{
+	glm::vec3 center = box.GetCenter();
+	glm::vec3 extent = box.GetExtent();
+	FrustumTest result = FRUSTUM_INSIDE;
+	for (int i = 0; i < 6; i++)
+	{
+		glm::vec3 normal(planes[i]);
+		float distance = glm::dot(normal, center) + planes[i].w;
+		float radius = glm::dot(glm::abs(normal), extent);
+		if (distance + radius < 0.0f)
+			return FRUSTUM_OUTSIDE;
+		if (distance - radius < 0.0f)
+			result = FRUSTUM_INTERSECTS;
+	}
+	return result;
+}
+
+std::size_t Frustum::Cull(const BoxList& boxes, std::vector<unsigned char>& visible) const
+{
+	std::size_t count = boxes.GetCount();
+	visible.resize(count);
+	std::size_t visibleCount = 0;
+	std::size_t i = 0;
+
+#ifdef FRUSTUM_SSE
+	__m128 zero = _mm_setzero_ps();
+	__m128 signMask = _mm_set1_ps(-0.0f);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(&boxes.centerX[i]);
+		__m128 cy = _mm_loadu_ps(&boxes.centerY[i]);
+		__m128 cz = _mm_loadu_ps(&boxes.centerZ[i]);
+		__m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+		__m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+		__m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 nx = _mm_set1_ps(planes[p].x);
+			__m128 ny = _mm_set1_ps(planes[p].y);
+			__m128 nz = _mm_set1_ps(planes[p].z);
+
+			// distance + radius, with the radius from the absolute normal
+			__m128 sum = _mm_set1_ps(planes[p].w);
+			sum = _mm_add_ps(sum, _mm_mul_ps(nx, cx));
+			sum = _mm_add_ps(sum, _mm_mul_ps(ny, cy));
+			sum = _mm_add_ps(sum, _mm_mul_ps(nz, cz));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_andnot_ps(signMask, nx), ex));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_andnot_ps(signMask, ny), ey));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(sum, zero));
+		}
+
+		int outsideMask = _mm_movemask_ps(outside);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			visible[i + lane] = (outsideMask >> lane & 1) == 0;
+			visibleCount += visible[i + lane];
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		glm::vec3 center(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]);
+		glm::vec3 extent(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+		visible[i] = IsVisible(center, extent);
+		visibleCount += visible[i];
+	}
+
+	return visibleCount;
+}
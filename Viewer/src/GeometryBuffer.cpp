@@ -0,0 +1,252 @@
+#include "GeometryBuffer.h"
+#include "VertexQuantizer.h"
+#include <algorithm>
+
+// the smallest buffers, in vertices and in indices
+static const std::size_t MinCapacity = 64 * 1024;
+
+GeometryBuffer::Pool::Pool() :
+	elementSize(0),
+	capacity(0),
+	count(0),
+	freeCount(0)
+{
+}
+
+GeometryBuffer::GeometryBuffer()
+{
+	vertexPools[0].elementSize = sizeof(Vertex);
+	vertexPools[1].elementSize = sizeof(CompactVertex);
+	indexPools[0].elementSize = sizeof(std::uint16_t);
+	indexPools[1].elementSize = sizeof(std::uint32_t);
+}
+
+void GeometryBuffer::Create()
+{
+	for (int i = 0; i < 2; i++) {
+		vertexPools[i].buffer.Create();
+		indexPools[i].buffer.Create();
+	}
+
+	// the buffers get their storage on the first Repack, the VAOs only refer to them by name
+	for (int vertexPool = 0; vertexPool < 2; vertexPool++) {
+		for (int indexPool = 0; indexPool < 2; indexPool++) {
+			vaos[vertexPool][indexPool].Create();
+			glBindVertexArray(vaos[vertexPool][indexPool].Get());
+			glBindBuffer(GL_ARRAY_BUFFER, vertexPools[vertexPool].buffer.Get());
+			SetVertexFormat(vertexPool == 1, 0);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexPools[indexPool].buffer.Get());
+		}
+	}
+	glBindVertexArray(0);
+}
+
+int GeometryBuffer::GetIndexPool(GLenum indexType)
+{
+	return indexType == GL_UNSIGNED_SHORT ? 0 : 1;
+}
+
+void GeometryBuffer::SetVertexFormat(bool compact, std::size_t offset)
+{
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	if (compact) {
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), (GLvoid*)(offset + offsetof(CompactVertex, position)));
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (GLvoid*)(offset + offsetof(CompactVertex, normal)));
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactVertex), (GLvoid*)(offset + offsetof(CompactVertex, textureCoords)));
+	}
+	else {
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(offset + offsetof(Vertex, position)));
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(offset + offsetof(Vertex, normal)));
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(offset + offsetof(Vertex, textureCoords)));
+	}
+}
+
+bool GeometryBuffer::Matches(const Allocation& allocation, const MeshResource& resource)
+{
+	return allocation.compact == resource.HasCompactVertices();
+}
+
+void GeometryBuffer::Respecify(Pool& pool, std::size_t needed)
+{
+	// grows in steps of 2, so adding meshes one at a time doesn't repack every time, and never shrinks
+	while (pool.capacity < needed)
+		pool.capacity = std::max(pool.capacity * 2, MinCapacity);
+
+	// respecifying orphans the old storage, draws still reading it keep it until they are done
+	glBindBuffer(GL_COPY_WRITE_BUFFER, pool.buffer.Get());
+	glBufferData(GL_COPY_WRITE_BUFFER, pool.capacity * pool.elementSize, NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	pool.count = 0;
+	pool.freeCount = 0;
+}
+
+void GeometryBuffer::Upload(const MeshResource& resource, const Allocation& allocation) const
+{
+	// the copy write target leaves the element buffer binding of whatever VAO is bound alone
+	const std::vector<Vertex>& vertices = resource.GetModelVertices();
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vertexPools[allocation.compact].buffer.Get());
+	if (allocation.compact) {
+		// against the mesh's own bounds, which ObjectData hands vshader.glsl to undo it
+		std::vector<CompactVertex> compact;
+		VertexQuantizer::Quantize(vertices, glm::vec3(resource.GetMin()), glm::vec3(resource.GetMax()), compact);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.baseVertex * sizeof(CompactVertex), compact.size() * sizeof(CompactVertex), compact.data());
+	}
+	else {
+		glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.baseVertex * sizeof(Vertex), vertices.size() * sizeof(Vertex), vertices.data());
+	}
+
+	// indices stay relative to the mesh's first vertex, the draws add baseVertex
+	const std::vector<std::uint32_t>& indices = resource.GetModelIndices();
+	const std::vector<std::uint32_t>& lodIndices = resource.GetLodIndices();
+	glBindBuffer(GL_COPY_WRITE_BUFFER, indexPools[GetIndexPool(allocation.indexType)].buffer.Get());
+	if (allocation.indexType == GL_UNSIGNED_SHORT) {
+		std::vector<std::uint16_t> shortIndices;
+		shortIndices.reserve(indices.size() + lodIndices.size());
+		shortIndices.insert(shortIndices.end(), indices.begin(), indices.end());
+		shortIndices.insert(shortIndices.end(), lodIndices.begin(), lodIndices.end());
+		glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.firstIndex * sizeof(std::uint16_t), shortIndices.size() * sizeof(std::uint16_t), shortIndices.data());
+	}
+	else {
+		glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.firstIndex * sizeof(std::uint32_t), indices.size() * sizeof(std::uint32_t), indices.data());
+		if (!lodIndices.empty())
+			glBufferSubData(GL_COPY_WRITE_BUFFER, (allocation.firstIndex + indices.size()) * sizeof(std::uint32_t), lodIndices.size() * sizeof(std::uint32_t), lodIndices.data());
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GeometryBuffer::Repack(int vertexPool, std::size_t extraVertices, int indexPool, std::size_t extraIndices)
+{
+	std::size_t neededVertices[2] = { 0, 0 };
+	std::size_t neededIndices[2] = { 0, 0 };
+	neededVertices[vertexPool] += extraVertices;
+	neededIndices[indexPool] += extraIndices;
+	for (std::unordered_map<const MeshResource*, Allocation>::iterator it = allocations.begin(); it != allocations.end();) {
+		std::shared_ptr<MeshResource> resource = it->second.resource.lock();
+		if (!resource || !Matches(it->second, *resource)) {
+			it = allocations.erase(it);
+			continue;
+		}
+		neededVertices[it->second.compact] += it->second.vertexCount;
+		neededIndices[GetIndexPool(it->second.indexType)] += it->second.indexCount;
+		++it;
+	}
+
+	// every mesh moves, and the VAOs of single meshes with it
+	meshVaos.clear();
+	for (int i = 0; i < 2; i++) {
+		Respecify(vertexPools[i], neededVertices[i]);
+		Respecify(indexPools[i], neededIndices[i]);
+	}
+
+	for (std::pair<const MeshResource* const, Allocation>& entry : allocations) {
+		Allocation& allocation = entry.second;
+		Pool& vertices = vertexPools[allocation.compact];
+		Pool& indices = indexPools[GetIndexPool(allocation.indexType)];
+		allocation.baseVertex = (GLint)vertices.count;
+		allocation.firstIndex = (std::uint32_t)indices.count;
+		Upload(*entry.first, allocation);
+		vertices.count += allocation.vertexCount;
+		indices.count += allocation.indexCount;
+	}
+}
+
+std::unordered_map<const MeshResource*, GeometryBuffer::Allocation>::iterator GeometryBuffer::Free(std::unordered_map<const MeshResource*, Allocation>::iterator it)
+{
+	vertexPools[it->second.compact].freeCount += it->second.vertexCount;
+	indexPools[GetIndexPool(it->second.indexType)].freeCount += it->second.indexCount;
+	meshVaos.erase(it->first);
+	return allocations.erase(it);
+}
+
+const GeometryBuffer::Allocation* GeometryBuffer::Find(const std::shared_ptr<MeshResource>& resource)
+{
+	std::unordered_map<const MeshResource*, Allocation>::iterator it = allocations.find(resource.get());
+	if (it != allocations.end()) {
+		if (it->second.resource.lock() == resource && Matches(it->second, *resource))
+			return &it->second;
+
+		// a new mesh at the address of one that went away, or one in the other vertex format now
+		Free(it);
+	}
+
+	bool compact = resource->HasCompactVertices();
+	GLenum indexType = resource->GetIndexType();
+	int indexPool = GetIndexPool(indexType);
+	std::size_t vertices = resource->GetModelVertices().size();
+	std::size_t indices = resource->GetModelIndices().size() + resource->GetLodIndices().size();
+	if (vertexPools[compact].count + vertices > vertexPools[compact].capacity || indexPools[indexPool].count + indices > indexPools[indexPool].capacity)
+		Repack(compact, vertices, indexPool, indices);
+
+	Allocation allocation = { resource, compact, indexType, (GLint)vertexPools[compact].count, (std::uint32_t)indexPools[indexPool].count, (std::uint32_t)vertices, (std::uint32_t)indices };
+	Upload(*resource, allocation);
+	vertexPools[compact].count += vertices;
+	indexPools[indexPool].count += indices;
+	return &(allocations[resource.get()] = allocation);
+}
+
+void GeometryBuffer::Collect()
+{
+	for (std::unordered_map<const MeshResource*, Allocation>::iterator it = allocations.begin(); it != allocations.end();) {
+		std::shared_ptr<MeshResource> resource = it->second.resource.lock();
+		if (resource && Matches(it->second, *resource))
+			++it;
+		else
+			it = Free(it);
+	}
+
+	for (int i = 0; i < 2; i++) {
+		if (vertexPools[i].freeCount > vertexPools[i].count / 2 || indexPools[i].freeCount > indexPools[i].count / 2) {
+			Repack(0, 0, 0, 0);
+			break;
+		}
+	}
+}
+
+GLuint GeometryBuffer::GetVAO(const Allocation& allocation) const
+{
+	return vaos[allocation.compact][GetIndexPool(allocation.indexType)].Get();
+}
+
+GLuint GeometryBuffer::GetMeshVAO(const MeshResource& resource)
+{
+	std::unordered_map<const MeshResource*, GLVertexArray>::const_iterator it = meshVaos.find(&resource);
+	if (it != meshVaos.end())
+		return it->second.Get();
+
+	// the same buffers as the shared VAOs, the attributes just start at the mesh's first vertex
+	const Allocation& allocation = allocations.at(&resource);
+	const Pool& vertices = vertexPools[allocation.compact];
+	GLVertexArray& vao = meshVaos[&resource];
+	vao.Create();
+	glBindVertexArray(vao.Get());
+	glBindBuffer(GL_ARRAY_BUFFER, vertices.buffer.Get());
+	SetVertexFormat(allocation.compact, allocation.baseVertex * vertices.elementSize);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexPools[GetIndexPool(allocation.indexType)].buffer.Get());
+	glBindVertexArray(0);
+	return vao.Get();
+}
+
+std::size_t GeometryBuffer::GetMeshCount() const
+{
+	return allocations.size();
+}
+
+std::size_t GeometryBuffer::GetUsedSize() const
+{
+	std::size_t size = 0;
+	for (int i = 0; i < 2; i++) {
+		size += (vertexPools[i].count - vertexPools[i].freeCount) * vertexPools[i].elementSize;
+		size += (indexPools[i].count - indexPools[i].freeCount) * indexPools[i].elementSize;
+	}
+	return size;
+}
+
+std::size_t GeometryBuffer::GetCapacity() const
+{
+	std::size_t size = 0;
+	for (int i = 0; i < 2; i++)
+		size += vertexPools[i].capacity * vertexPools[i].elementSize + indexPools[i].capacity * indexPools[i].elementSize;
+	return size;
+}
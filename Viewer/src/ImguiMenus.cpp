@@ -4,6 +4,10 @@
 #include "ImguiMenus.h"
 #include "MeshModel.h"
 #include "Utils.h"
+#include "BVHBenchmark.h"
+#include "RayCaster.h"
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <math.h>
 #include <memory>
@@ -21,6 +25,12 @@ bool incremental = false;
 bool lockScale = true;
 bool lockRotation = true;
 bool lockTranslation = true;
+bool optimizeMeshes = false;
+int benchmarkObjects = 100000;
+bool benchmarkDone = false;
+BVHBenchmarkResult benchmarkResult;
+std::string pickedName;
+double pickMs = 0.0;
 
 glm::vec4 clearColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.00f);
 
@@ -29,11 +39,11 @@ const glm::vec4& GetClearColor()
 	return clearColor;
 }
 
-void DrawImguiMenus(ImGuiIO& io, Scene& scene, Renderer& renderer)
+void DrawImguiMenus(ImGuiIO& io, Scene& scene, Renderer& renderer, MeshLoader& loader, TextureLoader& textureLoader, ResourceManager& resources)
 {
-	std::vector<std::shared_ptr<MeshModel>> models = scene.GetModels();
-	std::vector<Camera*> cameras = scene.GetCameras();
-	std::vector<Light*> lights = scene.GetLights();
+	const std::vector<std::shared_ptr<MeshModel>>& models = scene.GetModels();
+	const std::vector<Camera*>& cameras = scene.GetCameras();
+	const std::vector<Light*>& lights = scene.GetLights();
 
 	int activeModelIndex = scene.GetActiveModelIndex();
 	int activeCameraIndex = scene.GetActiveCameraIndex();
@@ -43,6 +53,27 @@ void DrawImguiMenus(ImGuiIO& io, Scene& scene, Renderer& renderer)
 	int camerasAmount = cameras.size();
 	int lightsAmount = lights.size();
 
+	// a click that is not on a window picks the model under the cursor
+	if (!io.WantCaptureMouse && ImGui::IsMouseClicked(0)) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		Ray ray = RayCaster::FromCursor(scene.GetActiveCameraState(), glm::vec2(io.MousePos.x, io.MousePos.y), glm::vec2(io.DisplaySize.x, io.DisplaySize.y));
+		float distance;
+		MeshModel* picked = renderer.Pick(ray, distance);
+		pickMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		pickedName = picked ? picked->GetModelName() : "nothing";
+		for (int i = 0; i < modelsAmount; i++) {
+			if (models[i].get() == picked)
+				scene.SetActiveModelIndex(i);
+		}
+		for (int i = 0; i < lightsAmount; i++) {
+			if (lights[i] == picked)
+				scene.activeLightIndex = i;
+		}
+		activeModelIndex = scene.GetActiveModelIndex();
+		activeLightIndex = scene.GetActiveLightIndex();
+	}
+
 	// 1. Show the big demo window (Most of the sample code is in ImGui::ShowDemoWindow()! You can browse its code to learn more about Dear ImGui!).
 	if (showDemoWindow)
 	{
@@ -53,7 +84,6 @@ void DrawImguiMenus(ImGuiIO& io, Scene& scene, Renderer& renderer)
 	{
 		static int counter = 0;
 		static int controlOverModel = 1;
-		static int textureProjection = 0;
 
 		Camera* activeCamera = cameras.at(activeCameraIndex);
 		Light* activeLight = lights.at(activeLightIndex);
@@ -67,6 +97,75 @@ void DrawImguiMenus(ImGuiIO& io, Scene& scene, Renderer& renderer)
 
 		ImGui::Begin("Mesh Model Viewer!");
 
+		if (loader.IsLoading()) {
+			ImGui::Text("Loading %s", loader.GetLoadingFile().c_str());
+			ImGui::ProgressBar(loader.GetProgress());
+			if (ImGui::Button("Cancel")) {
+				loader.Cancel();
+			}
+			ImGui::Separator();
+		}
+		else if (!loader.GetError().empty()) {
+			ImGui::Text("%s", loader.GetError().c_str());
+			ImGui::Separator();
+		}
+
+		if (textureLoader.IsLoading()) {
+			ImGui::Text("Loading textures...");
+			ImGui::Separator();
+		}
+
+		ImGui::Text("Draw calls: %d, state changes: %d", renderer.GetDrawCallCount(), renderer.GetStateChangeCount());
+		ImGui::Checkbox("Frustum culling", &renderer.frustumCulling);
+		ImGui::Text("Visible: %d, culled: %d", renderer.GetVisibleCount(), renderer.GetCulledCount());
+		ImGui::Checkbox("Occlusion culling", &renderer.occlusionCulling);
+		ImGui::Text("Conditional draws: %d, occluded: %d", renderer.GetConditionalDrawCount(), renderer.GetOccludedDrawCount());
+		ImGui::Checkbox("Level of detail", &renderer.levelOfDetail);
+		ImGui::Text("Triangles: %d", renderer.GetTriangleCount());
+		const char* submitModes[] = { "Loop", "Base vertex", "Multi-draw indirect" };
+		int submitMode = renderer.submitMode;
+		if (ImGui::Combo("Submission", &submitMode, submitModes, renderer.IsSubmitModeSupported(SUBMIT_MULTI_DRAW) ? 3 : 2))
+			renderer.submitMode = (SubmitMode)submitMode;
+		ImGui::Text("Submit CPU: loop %.3f ms, base vertex %.3f ms, multi-draw %.3f ms", renderer.GetSubmitMs(SUBMIT_LOOP),
+			renderer.GetSubmitMs(SUBMIT_BASE_VERTEX), renderer.GetSubmitMs(SUBMIT_MULTI_DRAW));
+		const GeometryBuffer& sharedGeometry = renderer.GetSharedGeometry();
+		ImGui::Text("Shared geometry: %d meshes, %.1f of %.1f MB", (int)sharedGeometry.GetMeshCount(),
+			sharedGeometry.GetUsedSize() / (1024.0f * 1024.0f), sharedGeometry.GetCapacity() / (1024.0f * 1024.0f));
+		const StreamBuffer& streamBuffer = renderer.GetStreamBuffer();
+		ImGui::Text("Stream buffer: %.1f MB, %s, waited %d times", streamBuffer.GetCapacity() / (1024.0f * 1024.0f),
+			streamBuffer.IsPersistent() ? "persistent" : "orphaned", streamBuffer.GetWaitCount());
+		const SceneBVH& sceneBVH = renderer.GetSceneBVH();
+		ImGui::Text("Scene BVH: %d nodes, depth %d, rebuilds: %d", (int)sceneBVH.GetNodeCount(), sceneBVH.GetDepth(), renderer.GetBVHRebuildCount());
+		if (!pickedName.empty())
+			ImGui::Text("Picked %s in %.3f ms", pickedName.c_str(), pickMs);
+		ImGui::Separator();
+
+		if (ImGui::CollapsingHeader("BVH Benchmark")) {
+			ImGui::InputInt("Objects", &benchmarkObjects, 1000, 10000);
+			benchmarkObjects = std::max(benchmarkObjects, 1);
+			if (ImGui::Button("Run")) {
+				benchmarkResult = BVHBenchmark::Run((std::size_t)benchmarkObjects);
+				benchmarkDone = true;
+			}
+			if (benchmarkDone) {
+				const BVHBenchmarkResult& result = benchmarkResult;
+				ImGui::Text("%d objects: %d nodes, depth %d", (int)result.objects, (int)result.nodes, result.depth);
+				ImGui::Text("Build: %.3f ms, refit: %.3f ms", result.buildMs, result.refitMs);
+				ImGui::Text("Frustum: %.3f ms (all boxes: %.3f ms), %d visible", result.frustumMs, result.linearCullMs, (int)result.visible);
+				ImGui::Text("1000 rays: %.3f ms, 1000 boxes: %.3f ms", result.rayMs, result.boxMs);
+			}
+			ImGui::Separator();
+		}
+
+		if (ImGui::CollapsingHeader("Resources")) {
+			const float kilobyte = 1024.0f;
+			for (const ResourceManager::ResidentResource& mesh : resources.GetResidentMeshes())
+				ImGui::Text("Mesh %s: %.1f KB, %ld users", mesh.name.c_str(), mesh.size / kilobyte, mesh.users);
+			for (const ResourceManager::ResidentResource& texture : resources.GetResidentTextures())
+				ImGui::Text("Texture %s: %.1f KB, %ld users", texture.name.c_str(), texture.size / kilobyte, texture.users);
+			ImGui::Separator();
+		}
+
 		if (ImGui::CollapsingHeader("Models") && modelsAmount > 0) {
 			std::shared_ptr<MeshModel> activeModel = models.at(activeModelIndex);
 			char** modelNames = new char*[modelsAmount];
@@ -78,6 +177,27 @@ void DrawImguiMenus(ImGuiIO& io, Scene& scene, Renderer& renderer)
 			
 			ImGui::Text("Active Model Preferences");
 
+			ImGui::Separator();
+			ImGui::Text("Geometry");
+			ImGui::Text("Triangles: %d", activeModel->GetIndexCount() / 3);
+			ImGui::Text("Vertices: %d (of %d corners)", (int)activeModel->GetModelVertices().size(), activeModel->GetIndexCount());
+			ImGui::Text("Indices: %d bit", (int)activeModel->GetIndexSize() * 8);
+			const float kilobyte = 1024.0f;
+			float unindexedSize = activeModel->GetUnindexedMemorySize() / kilobyte;
+			float videoSize = activeModel->GetVideoMemorySize() / kilobyte;
+			float systemSize = activeModel->GetSystemMemorySize() / kilobyte;
+			ImGui::Text("VRAM: %.1f KB (saved %.1f KB)", videoSize, unindexedSize - videoSize);
+			ImGui::Text("RAM: %.1f KB (saved %.1f KB)", systemSize, unindexedSize - systemSize);
+			bool compactVertices = activeModel->HasCompactVertices();
+			if (ImGui::Checkbox("Compact Vertices", &compactVertices))
+				activeModel->SetCompactVertices(compactVertices);
+			const VertexCacheStats& cacheStats = activeModel->GetCacheStats();
+			ImGui::Text("ACMR: %.3f ATVR: %.3f", cacheStats.acmr, cacheStats.atvr);
+			if (activeModel->IsOptimized()) {
+				const VertexCacheStats& originalStats = activeModel->GetOriginalCacheStats();
+				ImGui::Text("Optimized (was ACMR: %.3f ATVR: %.3f)", originalStats.acmr, originalStats.atvr);
+			}
+
 			ImGui::Separator();
 			ImGui::Text("Textures");
 			if (activeModel->loadedTexture)
@@ -90,11 +210,9 @@ void DrawImguiMenus(ImGuiIO& io, Scene& scene, Renderer& renderer)
 
 			if (activeModel->useTexture) {
 				ImGui::Text("Texture Projection:");
-				ImGui::RadioButton("Original", &(textureProjection), 0);
-				ImGui::RadioButton("Planar", &(textureProjection), 1);
-				ImGui::RadioButton("Cylindrical", &(textureProjection), 3);
-
-				activeModel->ChangeTextureProjection(textureProjection);
+				ImGui::RadioButton("Original", &(activeModel->textureProjection), ORIGINAL);
+				ImGui::RadioButton("Planar", &(activeModel->textureProjection), PLANAR);
+				ImGui::RadioButton("Cylindrical", &(activeModel->textureProjection), CYLINDRICAL);
 			}
 
 			ImGui::Separator();
@@ -206,7 +324,7 @@ void DrawImguiMenus(ImGuiIO& io, Scene& scene, Renderer& renderer)
 				glm::vec3 eye = activeCamera->eye,
 					at = activeCamera->at,
 					up = activeCamera->up;
-				Camera *c = new Camera(at, eye, up);
+				Camera *c = new Camera(resources, at, eye, up);
 				scene.AddCamera(c);
 			}
 
@@ -262,7 +380,7 @@ void DrawImguiMenus(ImGuiIO& io, Scene& scene, Renderer& renderer)
 			Light* activeLight = lights.at(activeLightIndex);
 			if (lights.size() < 5) {
 				if (ImGui::Button("Add Light")) {
-					Light *l = new Light();
+					Light *l = new Light(resources);
 					scene.AddLight(l);
 				}
 			}
@@ -335,12 +453,13 @@ void DrawImguiMenus(ImGuiIO& io, Scene& scene, Renderer& renderer)
 		{
 			if (ImGui::BeginMenu("File"))
 			{
-				if (ImGui::MenuItem("Load Model...", "CTRL+O"))
+				if (ImGui::MenuItem("Load Model...", "CTRL+O", false, !loader.IsLoading()))
 				{
 					nfdchar_t *outPath = NULL;
 					nfdresult_t result = NFD_OpenDialog("obj;png,jpg", NULL, &outPath);
 					if (result == NFD_OKAY) {
-						scene.AddModel(std::make_shared<MeshModel>(Utils::LoadMeshModel(outPath)));
+						// parsed on a worker thread, added to the scene by loader.Poll once it's done
+						loader.Load(outPath, optimizeMeshes);
 						free(outPath);
 					}
 					else if (result == NFD_CANCEL) {
@@ -349,6 +468,7 @@ void DrawImguiMenus(ImGuiIO& io, Scene& scene, Renderer& renderer)
 					}
 
 				}
+				ImGui::MenuItem("Optimize Loaded Meshes", NULL, &optimizeMeshes);
 				ImGui::EndMenu();
 			}
 
@@ -360,7 +480,8 @@ void DrawImguiMenus(ImGuiIO& io, Scene& scene, Renderer& renderer)
 					if (result == NFD_OKAY) {
 						std::vector<std::shared_ptr<MeshModel>> models = scene.GetModels();
 						std::shared_ptr<MeshModel> model = models.at(scene.GetActiveModelIndex());
-						model->LoadTexture(outPath);
+						// decoded on worker threads, applied by textureLoader.Poll once it's done
+						textureLoader.Load(outPath, model);
 						free(outPath);
 					}
 					else if (result == NFD_CANCEL) {
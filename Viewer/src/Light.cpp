@@ -1,11 +1,14 @@
 #include "Light.h"
 #include "Utils.h"
+#include "ResourceManager.h"
 #include <math.h>
 
 #define PI 3.14159265
 
-Light::Light() :
-	MeshModel(Utils::LoadMeshModel("..\\Data\\sphere.obj")),
+static const char* LightModelPath = "..\\Data\\sphere.obj";
+
+Light::Light(ResourceManager& resources) :
+	MeshModel(resources.LoadMesh(LightModelPath), Utils::GetFileName(LightModelPath)),
 	isPoint(true) {
 	this->color = glm::vec4(1);
 	this->translation = glm::vec3(10, 10, 0);
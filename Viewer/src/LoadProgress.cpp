@@ -0,0 +1,55 @@
+#include "LoadProgress.h"
+
+const float LoadProgress::ParseShare = 0.8f;
+
+LoadProgress::LoadProgress() :
+	fraction(0.0f),
+	cancelled(false),
+	parsedBytes(0),
+	totalBytes(0)
+{
+}
+
+void LoadProgress::Reset()
+{
+	fraction.store(0.0f);
+	cancelled.store(false);
+	parsedBytes.store(0);
+	totalBytes = 0;
+}
+
+void LoadProgress::StartParsing(std::size_t totalBytes)
+{
+	this->totalBytes = totalBytes;
+	parsedBytes.store(0);
+}
+
+void LoadProgress::AddParsedBytes(std::size_t bytes)
+{
+	// several chunks may be parsed at once, so the byte count is summed atomically
+	std::size_t parsed = parsedBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	if (totalBytes > 0)
+	{
+		fraction.store(ParseShare * (float)parsed / (float)totalBytes, std::memory_order_relaxed);
+	}
+}
+
+void LoadProgress::SetFraction(float fraction)
+{
+	this->fraction.store(fraction, std::memory_order_relaxed);
+}
+
+float LoadProgress::GetFraction() const
+{
+	return fraction.load(std::memory_order_relaxed);
+}
+
+void LoadProgress::Cancel()
+{
+	cancelled.store(true);
+}
+
+bool LoadProgress::IsCancelled() const
+{
+	return cancelled.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,155 @@
+#include "MappedFile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+	data(nullptr),
+	size(0),
+#ifdef _WIN32
+	fileHandle(INVALID_HANDLE_VALUE),
+	mappingHandle(nullptr)
+#else
+	fileDescriptor(-1)
+#endif
+{
+}
+
+MappedFile::MappedFile(const std::string& filePath) :
+	MappedFile()
+{
+	Open(filePath);
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& filePath)
+{
+	Close();
+
+#ifdef _WIN32
+	fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		std::cerr << "Error opening file '" << filePath << "'" << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		Close();
+		return false;
+	}
+
+	size = static_cast<std::size_t>(fileSize.QuadPart);
+
+	// an empty file can't be mapped, but it is still a valid (empty) file
+	if (size == 0)
+	{
+		return true;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == nullptr)
+	{
+		std::cerr << "Error mapping file '" << filePath << "'" << std::endl;
+		Close();
+		return false;
+	}
+
+	data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+	fileDescriptor = open(filePath.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		std::cerr << "Error opening file '" << filePath << "'" << std::endl;
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(fileDescriptor, &fileStat) != 0)
+	{
+		Close();
+		return false;
+	}
+
+	size = static_cast<std::size_t>(fileStat.st_size);
+
+	// an empty file can't be mapped, but it is still a valid (empty) file
+	if (size == 0)
+	{
+		return true;
+	}
+
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (mapping != MAP_FAILED)
+	{
+		// we walk the file front to back exactly once
+		madvise(mapping, size, MADV_SEQUENTIAL);
+		data = static_cast<const char*>(mapping);
+	}
+#endif
+
+	if (data == nullptr)
+	{
+		std::cerr << "Error mapping file '" << filePath << "'" << std::endl;
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data != nullptr)
+		UnmapViewOfFile(data);
+	if (mappingHandle != nullptr)
+		CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (data != nullptr)
+		munmap(const_cast<char*>(data), size);
+	if (fileDescriptor >= 0)
+		close(fileDescriptor);
+	fileDescriptor = -1;
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+bool MappedFile::IsOpen() const
+{
+#ifdef _WIN32
+	return fileHandle != INVALID_HANDLE_VALUE;
+#else
+	return fileDescriptor >= 0;
+#endif
+}
+
+const char* MappedFile::GetData() const
+{
+	return data;
+}
+
+std::size_t MappedFile::GetSize() const
+{
+	return size;
+}
@@ -0,0 +1,385 @@
+#include "MeshBVH.h"
+#include "MeshResource.h"
+#include "AABB.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHBVH_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+	// What Build partitions: one per triangle
+	struct BuildItem
+	{
+		AABB box;
+		glm::vec3 center;
+		std::uint32_t triangle;
+	};
+
+	// A range of items still to become a node; parent is the node whose right child it is, or NoTriangle for a left child
+	struct BuildTask
+	{
+		std::uint32_t first;
+		std::uint32_t count;
+		std::uint32_t parent;
+	};
+
+	bool IntersectNode(const MeshBVH::Node& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, float& entry)
+	{
+		float tmin = 0.0f;
+		float tmax = maxDistance;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float t0 = (node.mins[axis] - origin[axis]) * inverseDirection[axis];
+			float t1 = (node.maxs[axis] - origin[axis]) * inverseDirection[axis];
+			if (t0 > t1)
+				std::swap(t0, t1);
+			// written so that a NaN, from a zero direction on a box face, keeps the old bound
+			tmin = t0 > tmin ? t0 : tmin;
+			tmax = t1 < tmax ? t1 : tmax;
+			if (tmin > tmax)
+				return false;
+		}
+		entry = tmin;
+		return true;
+	}
+}
+
+MeshBVH::MeshBVH()
+{
+}
+
+void MeshBVH::Build(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices)
+{
+	nodes.clear();
+	packets.clear();
+
+	std::uint32_t triangleCount = (std::uint32_t)(indices.size() / 3);
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	std::vector<BuildItem> items(triangleCount);
+	for (std::uint32_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		BuildItem& item = items[triangle];
+		item.box = AABB();
+		for (int corner = 0; corner < 3; corner++)
+		{
+			item.box.Grow(vertices[indices[3 * triangle + corner]].position);
+		}
+		item.center = item.box.GetCenter();
+		item.triangle = triangle;
+	}
+
+	nodes.reserve(2 * (triangleCount / MaxLeafSize + 1));
+	packets.reserve(triangleCount / 2 + 1);
+
+	std::vector<BuildTask> stack;
+	BuildTask root = { 0, triangleCount, NoTriangle };
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		BuildTask task = stack.back();
+		stack.pop_back();
+
+		std::uint32_t nodeIndex = (std::uint32_t)nodes.size();
+		if (task.parent != NoTriangle)
+		{
+			nodes[task.parent].offset = nodeIndex;
+		}
+
+		BuildItem* begin = items.data() + task.first;
+		BuildItem* end = begin + task.count;
+
+		AABB box;
+		AABB centers;
+		for (const BuildItem* item = begin; item != end; item++)
+		{
+			box.Grow(item->box);
+			centers.Grow(item->center);
+		}
+
+		Node node;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			node.mins[axis] = box.mins[axis];
+			node.maxs[axis] = box.maxs[axis];
+		}
+		node.offset = 0;
+		node.count = 0;
+
+		// binned SAH as in SceneBVH, except that anything that fits a packet is a leaf: four triangles cost
+		// one test as much as one does. Anything bigger is always split
+		BuildItem* middle = end;
+		if (task.count > MaxLeafSize)
+		{
+			float parentArea = std::max(box.GetSurfaceArea(), 1e-12f);
+			float bestCost = std::numeric_limits<float>::max();
+			int bestAxis = -1;
+			int bestBin = 0;
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float low = centers.mins[axis];
+				float high = centers.maxs[axis];
+				if (high <= low)
+					continue;
+
+				AABB binBoxes[BinCount];
+				std::uint32_t binCounts[BinCount] = { 0 };
+				float scale = BinCount / (high - low);
+				for (const BuildItem* item = begin; item != end; item++)
+				{
+					int bin = std::min((int)((item->center[axis] - low) * scale), BinCount - 1);
+					binBoxes[bin].Grow(item->box);
+					binCounts[bin]++;
+				}
+
+				float rightAreas[BinCount];
+				std::uint32_t rightCounts[BinCount];
+				AABB right;
+				std::uint32_t rightCount = 0;
+				for (int bin = BinCount - 1; bin > 0; bin--)
+				{
+					right.Grow(binBoxes[bin]);
+					rightCount += binCounts[bin];
+					rightAreas[bin] = right.GetSurfaceArea();
+					rightCounts[bin] = rightCount;
+				}
+
+				AABB left;
+				std::uint32_t leftCount = 0;
+				for (int bin = 0; bin < BinCount - 1; bin++)
+				{
+					left.Grow(binBoxes[bin]);
+					leftCount += binCounts[bin];
+					if (leftCount == 0 || rightCounts[bin + 1] == 0)
+						continue;
+
+					float cost = 1.0f + (left.GetSurfaceArea() * leftCount + rightAreas[bin + 1] * rightCounts[bin + 1]) / parentArea;
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = bin;
+					}
+				}
+			}
+
+			if (bestAxis >= 0)
+			{
+				float low = centers.mins[bestAxis];
+				float scale = BinCount / (centers.maxs[bestAxis] - low);
+				middle = std::partition(begin, end, [&](const BuildItem& item) {
+					int bin = std::min((int)((item.center[bestAxis] - low) * scale), BinCount - 1);
+					return bin <= bestBin;
+				});
+			}
+			else
+			{
+				// every center in the same place: any halving is as good as another
+				middle = begin + task.count / 2;
+			}
+		}
+
+		if (middle == end)
+		{
+			node.offset = (std::uint32_t)packets.size();
+			node.count = task.count;
+			nodes.push_back(node);
+
+			TrianglePacket packet;
+			std::memset(&packet, 0, sizeof(packet));
+			for (std::uint32_t lane = 0; lane < 4; lane++)
+			{
+				packet.triangles[lane] = NoTriangle;
+			}
+			for (std::uint32_t lane = 0; lane < task.count; lane++)
+			{
+				std::uint32_t triangle = begin[lane].triangle;
+				const glm::vec3& v0 = vertices[indices[3 * triangle]].position;
+				glm::vec3 edge1 = vertices[indices[3 * triangle + 1]].position - v0;
+				glm::vec3 edge2 = vertices[indices[3 * triangle + 2]].position - v0;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					packet.v0[axis][lane] = v0[axis];
+					packet.edge1[axis][lane] = edge1[axis];
+					packet.edge2[axis][lane] = edge2[axis];
+				}
+				packet.triangles[lane] = triangle;
+			}
+			packets.push_back(packet);
+			continue;
+		}
+
+		nodes.push_back(node);
+
+		// the left child is popped next, so it lands right after this node
+		std::uint32_t leftCount = (std::uint32_t)(middle - begin);
+		BuildTask right = { task.first + leftCount, task.count - leftCount, nodeIndex };
+		BuildTask left = { task.first, leftCount, NoTriangle };
+		stack.push_back(right);
+		stack.push_back(left);
+	}
+}
+
+static std::uint32_t IntersectPacket(const MeshBVH::TrianglePacket& packet, const glm::vec3& origin, const glm::vec3& direction, float& distance)
+{
+	const float Epsilon = 1e-12f;
+	std::uint32_t nearest = MeshBVH::NoTriangle;
+
+#ifdef MESHBVH_SSE
+	__m128 ex1 = _mm_loadu_ps(packet.edge1[0]);
+	__m128 ey1 = _mm_loadu_ps(packet.edge1[1]);
+	__m128 ez1 = _mm_loadu_ps(packet.edge1[2]);
+	__m128 ex2 = _mm_loadu_ps(packet.edge2[0]);
+	__m128 ey2 = _mm_loadu_ps(packet.edge2[1]);
+	__m128 ez2 = _mm_loadu_ps(packet.edge2[2]);
+	__m128 dx = _mm_set1_ps(direction.x);
+	__m128 dy = _mm_set1_ps(direction.y);
+	__m128 dz = _mm_set1_ps(direction.z);
+
+	// Moller-Trumbore: p = d x e2, det = e1 . p
+	__m128 px = _mm_sub_ps(_mm_mul_ps(dy, ez2), _mm_mul_ps(dz, ey2));
+	__m128 py = _mm_sub_ps(_mm_mul_ps(dz, ex2), _mm_mul_ps(dx, ez2));
+	__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, ey2), _mm_mul_ps(dy, ex2));
+	__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex1, px), _mm_mul_ps(ey1, py)), _mm_mul_ps(ez1, pz));
+
+	// both sides count, so only a ray in the triangle's plane (or a padding lane) is rejected here
+	__m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 valid = _mm_cmpgt_ps(_mm_andnot_ps(signMask, det), _mm_set1_ps(Epsilon));
+	__m128 inverseDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+	__m128 tx = _mm_sub_ps(_mm_set1_ps(origin.x), _mm_loadu_ps(packet.v0[0]));
+	__m128 ty = _mm_sub_ps(_mm_set1_ps(origin.y), _mm_loadu_ps(packet.v0[1]));
+	__m128 tz = _mm_sub_ps(_mm_set1_ps(origin.z), _mm_loadu_ps(packet.v0[2]));
+	__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), inverseDet);
+
+	// q = s x e1
+	__m128 qx = _mm_sub_ps(_mm_mul_ps(ty, ez1), _mm_mul_ps(tz, ey1));
+	__m128 qy = _mm_sub_ps(_mm_mul_ps(tz, ex1), _mm_mul_ps(tx, ez1));
+	__m128 qz = _mm_sub_ps(_mm_mul_ps(tx, ey1), _mm_mul_ps(ty, ex1));
+	__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverseDet);
+	__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ex2, qx), _mm_mul_ps(ey2, qy)), _mm_mul_ps(ez2, qz)), inverseDet);
+
+	__m128 zero = _mm_setzero_ps();
+	valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+	valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+	valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+	valid = _mm_and_ps(valid, _mm_cmpge_ps(t, zero));
+	valid = _mm_and_ps(valid, _mm_cmple_ps(t, _mm_set1_ps(distance)));
+
+	int hits = _mm_movemask_ps(valid);
+	if (hits == 0)
+		return nearest;
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, t);
+	for (int lane = 0; lane < 4; lane++)
+	{
+		if ((hits >> lane & 1) && lanes[lane] <= distance)
+		{
+			distance = lanes[lane];
+			nearest = packet.triangles[lane];
+		}
+	}
+#else
+	for (int lane = 0; lane < 4; lane++)
+	{
+		glm::vec3 edge1(packet.edge1[0][lane], packet.edge1[1][lane], packet.edge1[2][lane]);
+		glm::vec3 edge2(packet.edge2[0][lane], packet.edge2[1][lane], packet.edge2[2][lane]);
+		glm::vec3 p = glm::cross(direction, edge2);
+		float det = glm::dot(edge1, p);
+		if (std::fabs(det) <= Epsilon)
+			continue;
+
+		float inverseDet = 1.0f / det;
+		glm::vec3 s = origin - glm::vec3(packet.v0[0][lane], packet.v0[1][lane], packet.v0[2][lane]);
+		float u = glm::dot(s, p) * inverseDet;
+		if (u < 0.0f || u > 1.0f)
+			continue;
+
+		glm::vec3 q = glm::cross(s, edge1);
+		float v = glm::dot(direction, q) * inverseDet;
+		if (v < 0.0f || u + v > 1.0f)
+			continue;
+
+		float t = glm::dot(edge2, q) * inverseDet;
+		if (t >= 0.0f && t <= distance)
+		{
+			distance = t;
+			nearest = packet.triangles[lane];
+		}
+	}
+#endif
+
+	return nearest;
+}
+
+std::uint32_t MeshBVH::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance) const
+{
+	std::uint32_t nearest = NoTriangle;
+	distance = maxDistance;
+	if (nodes.empty())
+		return nearest;
+
+	glm::vec3 inverseDirection = glm::vec3(1.0f) / direction;
+	float entry;
+	if (!IntersectNode(nodes[0], origin, inverseDirection, distance, entry))
+		return nearest;
+
+	std::vector<std::uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (node.count != 0)
+		{
+			std::uint32_t triangle = IntersectPacket(packets[node.offset], origin, direction, distance);
+			if (triangle != NoTriangle)
+				nearest = triangle;
+			continue;
+		}
+
+		// the children are tested here rather than when popped, so the nearer one goes on top
+		std::uint32_t left = (std::uint32_t)(&node - nodes.data()) + 1;
+		std::uint32_t right = node.offset;
+		float leftEntry, rightEntry;
+		bool leftHit = IntersectNode(nodes[left], origin, inverseDirection, distance, leftEntry);
+		bool rightHit = IntersectNode(nodes[right], origin, inverseDirection, distance, rightEntry);
+		if (leftHit && rightHit)
+		{
+			stack.push_back(leftEntry < rightEntry ? right : left);
+			stack.push_back(leftEntry < rightEntry ? left : right);
+		}
+		else if (leftHit)
+		{
+			stack.push_back(left);
+		}
+		else if (rightHit)
+		{
+			stack.push_back(right);
+		}
+	}
+	return nearest;
+}
+
+std::size_t MeshBVH::GetNodeCount() const
+{
+	return nodes.size();
+}
+
+std::size_t MeshBVH::GetMemorySize() const
+{
+	return nodes.size() * sizeof(Node) + packets.size() * sizeof(TrianglePacket);
+}
@@ -0,0 +1,323 @@
+#include "MeshCache.h"
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+static const char MeshCacheMagic[8] = { 'M', 'E', 'S', 'H', 'B', 'I', 'N', '\0' };
+
+MeshCache::MeshCache() :
+	header(nullptr),
+	staleTime(false)
+{
+}
+
+std::string MeshCache::GetCachePath(const std::string& sourcePath, bool optimized)
+{
+	return sourcePath + (optimized ? ".opt.meshbin" : ".meshbin");
+}
+
+//-----------------------------------------------------------------------------
+// FNV-1a, 64 bit
+//-----------------------------------------------------------------------------
+std::uint64_t MeshCache::HashBytes(const char* data, std::size_t size)
+{
+	std::uint64_t hash = 14695981039346656037ull;
+	for (std::size_t i = 0; i < size; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::size_t MeshCache::Align(std::size_t offset)
+{
+	return (offset + 15) & ~(std::size_t)15;
+}
+
+void MeshCache::ComputeSizes(const MeshCacheHeader& header, std::size_t sizes[SectionCount])
+{
+	sizes[MODEL_VERTICES] = header.modelVertexCount * sizeof(Vertex);
+	sizes[MODEL_INDICES] = header.modelIndexCount * sizeof(std::uint32_t);
+	sizes[VERTICES] = header.vertexCount * sizeof(glm::vec3);
+	sizes[NORMALS] = header.normalCount * sizeof(glm::vec3);
+	sizes[TEXTURE_COORDS] = header.textureCoordCount * sizeof(glm::vec2);
+	sizes[POSITION_INDICES] = header.cornerCount * sizeof(std::uint32_t);
+	sizes[NORMAL_INDICES] = header.cornerCount * sizeof(std::uint32_t);
+	sizes[TEXTURE_INDICES] = header.cornerCount * sizeof(std::uint32_t);
+	sizes[LOD_INDICES] = header.lodIndexCount * sizeof(std::uint32_t);
+	sizes[LODS] = header.lodCount * sizeof(MeshLod);
+}
+
+void MeshCache::ComputeOffsets(const MeshCacheHeader& header, std::size_t offsets[SectionCount + 1])
+{
+	std::size_t sizes[SectionCount];
+	ComputeSizes(header, sizes);
+
+	offsets[0] = Align(sizeof(MeshCacheHeader));
+	for (int i = 0; i < SectionCount; i++)
+	{
+		offsets[i + 1] = Align(offsets[i] + sizes[i]);
+	}
+}
+
+bool MeshCache::GetSourceKey(const std::string& sourcePath, std::uint64_t& pathHash, std::uint64_t& size, std::int64_t& time)
+{
+	std::error_code error;
+	std::filesystem::path path = std::filesystem::weakly_canonical(sourcePath, error);
+	if (error)
+	{
+		path = sourcePath;
+	}
+
+	size = std::filesystem::file_size(path, error);
+	if (error)
+	{
+		return false;
+	}
+
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+	if (error)
+	{
+		return false;
+	}
+
+	std::string pathString = path.string();
+	pathHash = HashBytes(pathString.data(), pathString.size());
+	time = (std::int64_t)writeTime.time_since_epoch().count();
+	return true;
+}
+
+bool MeshCache::Open(const std::string& sourcePath, bool optimized)
+{
+	header = nullptr;
+	staleTime = false;
+
+	std::uint64_t pathHash, sourceSize;
+	std::int64_t sourceTime;
+	if (!GetSourceKey(sourcePath, pathHash, sourceSize, sourceTime))
+	{
+		return false;
+	}
+
+	std::string cachePath = GetCachePath(sourcePath, optimized);
+	std::error_code error;
+	if (!std::filesystem::exists(cachePath, error) || !file.Open(cachePath))
+	{
+		return false;
+	}
+
+	if (file.GetSize() < sizeof(MeshCacheHeader))
+	{
+		file.Close();
+		return false;
+	}
+
+	const MeshCacheHeader* candidate = reinterpret_cast<const MeshCacheHeader*>(file.GetData());
+	if (std::memcmp(candidate->magic, MeshCacheMagic, sizeof(MeshCacheMagic)) != 0 ||
+		candidate->version != Version ||
+		candidate->vertexSize != sizeof(Vertex) ||
+		((candidate->flags & OPTIMIZED) != 0) != optimized ||
+		candidate->pathHash != pathHash ||
+		candidate->sourceSize != sourceSize)
+	{
+		file.Close();
+		return false;
+	}
+
+	ComputeOffsets(*candidate, offsets);
+	if (offsets[SectionCount] > file.GetSize())
+	{
+		file.Close();
+		return false;
+	}
+
+	// same size but touched: only trust the cache if the content is still the same
+	if (candidate->sourceTime != sourceTime)
+	{
+		MappedFile source(sourcePath);
+		if (!source.IsOpen() || HashBytes(source.GetData(), source.GetSize()) != candidate->sourceHash)
+		{
+			file.Close();
+			return false;
+		}
+		staleTime = true;
+	}
+
+	header = candidate;
+	return true;
+}
+
+bool MeshCache::Write(const std::string& sourcePath, const MeshData& data)
+{
+	MeshCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MeshCacheMagic, sizeof(MeshCacheMagic));
+	header.version = Version;
+	header.vertexSize = sizeof(Vertex);
+
+	if (!GetSourceKey(sourcePath, header.pathHash, header.sourceSize, header.sourceTime))
+	{
+		return false;
+	}
+
+	{
+		MappedFile source(sourcePath);
+		if (!source.IsOpen())
+		{
+			return false;
+		}
+		header.sourceHash = HashBytes(source.GetData(), source.GetSize());
+	}
+
+	header.mins = data.mins;
+	header.maxs = data.maxs;
+	header.avg = data.avg;
+	header.flags = data.optimized ? OPTIMIZED : 0;
+	header.originalCacheStats = data.originalCacheStats;
+	header.modelVertexCount = data.modelVertices.size();
+	header.modelIndexCount = data.modelIndices.size();
+	header.vertexCount = data.vertices.size();
+	header.normalCount = data.normals.size();
+	header.textureCoordCount = data.textureCoords.size();
+	header.cornerCount = data.mesh.GetCornerCount();
+	header.lodIndexCount = data.lodIndices.size();
+	header.lodCount = data.lods.size();
+
+	std::size_t sizes[SectionCount];
+	std::size_t offsets[SectionCount + 1];
+	ComputeSizes(header, sizes);
+	ComputeOffsets(header, offsets);
+
+	const void* sections[SectionCount] = {
+		data.modelVertices.data(),
+		data.modelIndices.data(),
+		data.vertices.data(),
+		data.normals.data(),
+		data.textureCoords.data(),
+		data.mesh.positionIndices.data(),
+		data.mesh.normalIndices.data(),
+		data.mesh.textureIndices.data(),
+		data.lodIndices.data(),
+		data.lods.data()
+	};
+
+	std::ofstream out(GetCachePath(sourcePath, data.optimized), std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		// e.g. a read-only data directory; we'll just parse again next time
+		return false;
+	}
+
+	static const char padding[16] = { 0 };
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(padding, offsets[0] - sizeof(header));
+	for (int i = 0; i < SectionCount; i++)
+	{
+		out.write(static_cast<const char*>(sections[i]), sizes[i]);
+		out.write(padding, offsets[i + 1] - offsets[i] - sizes[i]);
+	}
+
+	return (bool)out;
+}
+
+bool MeshCache::HasStaleTime() const
+{
+	return staleTime;
+}
+
+bool MeshCache::Restamp(const std::string& sourcePath, bool optimized)
+{
+	std::uint64_t pathHash, sourceSize;
+	std::int64_t sourceTime;
+	if (!GetSourceKey(sourcePath, pathHash, sourceSize, sourceTime))
+	{
+		return false;
+	}
+
+	// the cache must not be mapped any more, Windows won't write to a mapped file
+	std::fstream out(GetCachePath(sourcePath, optimized), std::ios::binary | std::ios::in | std::ios::out);
+	if (!out)
+	{
+		return false;
+	}
+	out.seekp(offsetof(MeshCacheHeader, sourceTime));
+	out.write(reinterpret_cast<const char*>(&sourceTime), sizeof(sourceTime));
+	return (bool)out;
+}
+
+void MeshCache::Read(MeshData& data) const
+{
+	data.mins = header->mins;
+	data.maxs = header->maxs;
+	data.avg = header->avg;
+	data.optimized = (header->flags & OPTIMIZED) != 0;
+	data.originalCacheStats = header->originalCacheStats;
+	data.modelVertices.assign(GetModelVertices(), GetModelVertices() + header->modelVertexCount);
+	data.modelIndices.assign(GetModelIndices(), GetModelIndices() + header->modelIndexCount);
+	data.vertices.assign(GetVertices(), GetVertices() + header->vertexCount);
+	data.normals.assign(GetNormals(), GetNormals() + header->normalCount);
+	data.textureCoords.assign(GetTextureCoords(), GetTextureCoords() + header->textureCoordCount);
+	data.mesh.positionIndices.assign(GetPositionIndices(), GetPositionIndices() + header->cornerCount);
+	data.mesh.normalIndices.assign(GetNormalIndices(), GetNormalIndices() + header->cornerCount);
+	data.mesh.textureIndices.assign(GetTextureIndices(), GetTextureIndices() + header->cornerCount);
+	data.lodIndices.assign(GetLodIndices(), GetLodIndices() + header->lodIndexCount);
+	data.lods.assign(GetLods(), GetLods() + header->lodCount);
+}
+
+const MeshCacheHeader& MeshCache::GetHeader() const
+{
+	return *header;
+}
+
+const Vertex* MeshCache::GetModelVertices() const
+{
+	return reinterpret_cast<const Vertex*>(file.GetData() + offsets[MODEL_VERTICES]);
+}
+
+const std::uint32_t* MeshCache::GetModelIndices() const
+{
+	return reinterpret_cast<const std::uint32_t*>(file.GetData() + offsets[MODEL_INDICES]);
+}
+
+const glm::vec3* MeshCache::GetVertices() const
+{
+	return reinterpret_cast<const glm::vec3*>(file.GetData() + offsets[VERTICES]);
+}
+
+const glm::vec3* MeshCache::GetNormals() const
+{
+	return reinterpret_cast<const glm::vec3*>(file.GetData() + offsets[NORMALS]);
+}
+
+const glm::vec2* MeshCache::GetTextureCoords() const
+{
+	return reinterpret_cast<const glm::vec2*>(file.GetData() + offsets[TEXTURE_COORDS]);
+}
+
+const std::uint32_t* MeshCache::GetPositionIndices() const
+{
+	return reinterpret_cast<const std::uint32_t*>(file.GetData() + offsets[POSITION_INDICES]);
+}
+
+const std::uint32_t* MeshCache::GetNormalIndices() const
+{
+	return reinterpret_cast<const std::uint32_t*>(file.GetData() + offsets[NORMAL_INDICES]);
+}
+
+const std::uint32_t* MeshCache::GetTextureIndices() const
+{
+	return reinterpret_cast<const std::uint32_t*>(file.GetData() + offsets[TEXTURE_INDICES]);
+}
+
+const std::uint32_t* MeshCache::GetLodIndices() const
+{
+	return reinterpret_cast<const std::uint32_t*>(file.GetData() + offsets[LOD_INDICES]);
+}
+
+const MeshLod* MeshCache::GetLods() const
+{
+	return reinterpret_cast<const MeshLod*>(file.GetData() + offsets[LODS]);
+}
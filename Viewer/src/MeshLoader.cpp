@@ -0,0 +1,130 @@
+#include "MeshLoader.h"
+#include "Scene.h"
+#include "ResourceManager.h"
+#include "Utils.h"
+
+MeshLoader::MeshLoader(ResourceManager& resources) :
+	resources(resources),
+	busy(false)
+{
+}
+
+MeshLoader::~MeshLoader()
+{
+	Cancel();
+	if (worker.joinable())
+	{
+		worker.join();
+	}
+}
+
+bool MeshLoader::Load(const std::string& filePath, bool optimize)
+{
+	// a resident mesh only does if it is in the order asked for
+	std::string fileKey = ResourceManager::GetFileKey(filePath);
+	std::shared_ptr<MeshResource> mesh = resources.FindMesh(fileKey);
+	if (mesh && mesh->IsOptimized() == optimize)
+	{
+		resident.push_back(std::make_shared<MeshModel>(mesh, Utils::GetFileName(filePath)));
+		return true;
+	}
+
+	if (IsLoading())
+	{
+		return false;
+	}
+
+	// the previous worker has already finished, this only reclaims its thread
+	if (worker.joinable())
+	{
+		worker.join();
+	}
+
+	loadingFile = Utils::GetFileName(filePath);
+	error.clear();
+	progress.Reset();
+	busy.store(true);
+	worker = std::thread(&MeshLoader::Run, this, filePath, fileKey, optimize);
+	return true;
+}
+
+void MeshLoader::Run(std::string filePath, std::string fileKey, bool optimize)
+{
+	std::unique_ptr<LoadedMesh> loaded(new LoadedMesh());
+	loaded->name = Utils::GetFileName(filePath);
+	loaded->fileKey = fileKey;
+	loaded->hash = 0;
+
+	// a cancelled load just ends, a failed one still goes to Poll, which reports it
+	bool loadedData = Utils::LoadMeshData(filePath, loaded->data, &progress, optimize);
+	if (!progress.IsCancelled())
+	{
+		loaded->failed = !loadedData;
+		if (loadedData)
+		{
+			loaded->hash = ResourceManager::HashMeshData(loaded->data);
+		}
+
+		// one load at a time, so the queue only fills up if Poll isn't called for a while
+		while (!finished.Push(std::move(loaded)) && !progress.IsCancelled())
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	busy.store(false);
+}
+
+void MeshLoader::Cancel()
+{
+	progress.Cancel();
+}
+
+bool MeshLoader::IsLoading() const
+{
+	return busy.load();
+}
+
+float MeshLoader::GetProgress() const
+{
+	return progress.GetFraction();
+}
+
+const std::string& MeshLoader::GetLoadingFile() const
+{
+	return loadingFile;
+}
+
+const std::string& MeshLoader::GetError() const
+{
+	return error;
+}
+
+void MeshLoader::Poll(Scene& scene)
+{
+	for (const std::shared_ptr<MeshModel>& model : resident)
+	{
+		scene.AddModel(model);
+	}
+	resident.clear();
+
+	std::unique_ptr<LoadedMesh> loaded;
+	while (finished.Pop(loaded))
+	{
+		if (loaded->failed)
+		{
+			error = "Unable to load " + loaded->name;
+			continue;
+		}
+		error.clear();
+
+		// the same content may be resident under another file name, then nothing is uploaded
+		std::shared_ptr<MeshResource> mesh = resources.FindMesh(loaded->hash);
+		if (!mesh)
+		{
+			mesh = std::make_shared<MeshResource>(std::move(loaded->data));
+		}
+		mesh = resources.AddMesh(loaded->fileKey, loaded->hash, loaded->name, mesh);
+		scene.AddModel(std::make_shared<MeshModel>(mesh, loaded->name));
+	}
+}
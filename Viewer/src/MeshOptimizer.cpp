@@ -0,0 +1,338 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <numeric>
+
+//-----------------------------------------------------------------------------
+// A FIFO vertex cache simulated with timestamps: a vertex is cached if it
+// missed less than cacheSize misses ago. Flush() empties it in O(1).
+//-----------------------------------------------------------------------------
+struct FifoCache
+{
+	std::vector<std::uint32_t> timestamps;
+	std::uint32_t time;
+	std::uint32_t size;
+
+	FifoCache(std::size_t vertexCount, std::uint32_t size) :
+		timestamps(vertexCount, 0),
+		time(size + 1),
+		size(size)
+	{
+	}
+
+	// returns 1 on a miss
+	unsigned int Touch(std::uint32_t vertex)
+	{
+		if (time - timestamps[vertex] > size)
+		{
+			timestamps[vertex] = time++;
+			return 1;
+		}
+		return 0;
+	}
+
+	void Flush()
+	{
+		time += size + 1;
+	}
+};
+
+void MeshOptimizer::Optimize(MeshData& data)
+{
+	data.originalCacheStats = AnalyzeVertexCache(data.modelIndices, data.modelVertices.size());
+
+	std::vector<std::uint32_t> indices(data.modelIndices);
+	std::vector<std::uint32_t> clusters;
+	OptimizeVertexCache(indices, data.modelVertices.size(), &clusters);
+
+	glm::vec3 center = glm::vec3(data.mins + data.maxs) * 0.5f;
+	OptimizeOverdraw(indices, data.modelVertices, clusters, center);
+
+	// some exporters already write a cache friendly order, keep it then
+	if (AnalyzeVertexCache(indices, data.modelVertices.size()).acmr < data.originalCacheStats.acmr)
+	{
+		data.modelIndices.swap(indices);
+	}
+
+	OptimizeVertexFetch(data.modelVertices, data.modelIndices);
+	data.optimized = true;
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<std::uint32_t>& indices, std::size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats;
+	if (indices.empty())
+	{
+		return stats;
+	}
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<unsigned char> used(vertexCount, 0);
+	std::size_t misses = 0;
+	std::size_t usedCount = 0;
+	for (std::uint32_t index : indices)
+	{
+		misses += cache.Touch(index);
+		usedCount += !used[index];
+		used[index] = 1;
+	}
+
+	stats.acmr = (float)misses / (indices.size() / 3);
+	stats.atvr = (float)misses / usedCount;
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<std::uint32_t>& indices, std::size_t vertexCount, std::vector<std::uint32_t>* clusters)
+{
+	std::size_t triangleCount = indices.size() / 3;
+	if (clusters != nullptr)
+	{
+		clusters->clear();
+	}
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// vertex -> adjacent triangles, in one flat array
+	std::vector<std::uint32_t> offsets(vertexCount + 1, 0);
+	for (std::uint32_t index : indices)
+	{
+		offsets[index + 1]++;
+	}
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+	std::vector<std::uint32_t> adjacency(indices.size());
+	std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (std::size_t i = 0; i < indices.size(); i++)
+	{
+		adjacency[fill[indices[i]]++] = (std::uint32_t)(i / 3);
+	}
+
+	// triangles not emitted yet, per vertex
+	std::vector<std::uint32_t> liveTriangles(vertexCount);
+	for (std::size_t v = 0; v < vertexCount; v++)
+	{
+		liveTriangles[v] = offsets[v + 1] - offsets[v];
+	}
+
+	std::vector<std::uint32_t> cacheTime(vertexCount, 0);
+	std::vector<unsigned char> emitted(triangleCount, 0);
+	std::vector<std::uint32_t> deadEnd;
+	std::vector<std::uint32_t> candidates;
+	std::vector<std::uint32_t> output;
+	deadEnd.reserve(indices.size());
+	output.reserve(indices.size());
+
+	std::uint32_t time = CacheSize + 1;
+	std::size_t cursor = 0;
+	std::uint32_t fanning = indices[0];
+	bool flushed = true;
+
+	while (fanning != IndexedMesh::NoIndex)
+	{
+		if (flushed && clusters != nullptr)
+		{
+			clusters->push_back((std::uint32_t)(output.size() / 3));
+		}
+
+		// emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for (std::uint32_t i = offsets[fanning]; i < offsets[fanning + 1]; i++)
+		{
+			std::uint32_t triangle = adjacency[i];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+			emitted[triangle] = 1;
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				std::uint32_t vertex = indices[3 * triangle + corner];
+				output.push_back(vertex);
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+				if (time - cacheTime[vertex] > CacheSize)
+				{
+					cacheTime[vertex] = time++;
+				}
+			}
+		}
+
+		// next: the oldest candidate that will still be in the cache after its own fan
+		std::uint32_t next = IndexedMesh::NoIndex;
+		std::uint32_t bestPriority = 0;
+		for (std::uint32_t vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0)
+			{
+				continue;
+			}
+
+			std::uint32_t priority = 0;
+			if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= CacheSize)
+			{
+				priority = time - cacheTime[vertex];
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = vertex;
+			}
+		}
+
+		flushed = false;
+		if (next == IndexedMesh::NoIndex)
+		{
+			// dead end: go back to the most recent vertex with work left, or else to any vertex
+			flushed = true;
+			while (!deadEnd.empty() && next == IndexedMesh::NoIndex)
+			{
+				std::uint32_t vertex = deadEnd.back();
+				deadEnd.pop_back();
+				if (liveTriangles[vertex] > 0)
+				{
+					next = vertex;
+				}
+			}
+			while (next == IndexedMesh::NoIndex && cursor < vertexCount)
+			{
+				if (liveTriangles[cursor] > 0)
+				{
+					next = (std::uint32_t)cursor;
+				}
+				cursor++;
+			}
+		}
+
+		fanning = next;
+	}
+
+	indices.swap(output);
+}
+
+std::size_t MeshOptimizer::BuildSoftClusters(const std::vector<std::uint32_t>& indices, std::size_t vertexCount, const std::vector<std::uint32_t>& hardClusters, float threshold, std::vector<std::uint32_t>& clusters)
+{
+	// split each hard cluster wherever the part so far is already about as cache efficient as the whole
+	std::size_t triangleCount = indices.size() / 3;
+	FifoCache cache(vertexCount, CacheSize);
+
+	clusters.clear();
+	for (std::size_t c = 0; c < hardClusters.size(); c++)
+	{
+		std::size_t start = hardClusters[c];
+		std::size_t end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : triangleCount;
+
+		cache.Flush();
+		std::size_t clusterMisses = 0;
+		for (std::size_t i = 3 * start; i < 3 * end; i++)
+		{
+			clusterMisses += cache.Touch(indices[i]);
+		}
+		float acceptedAcmr = threshold * clusterMisses / (end - start);
+
+		cache.Flush();
+		clusters.push_back((std::uint32_t)start);
+		std::size_t misses = 0;
+		std::size_t triangles = 0;
+		for (std::size_t i = start; i < end; i++)
+		{
+			misses += cache.Touch(indices[3 * i + 0]);
+			misses += cache.Touch(indices[3 * i + 1]);
+			misses += cache.Touch(indices[3 * i + 2]);
+			triangles++;
+
+			if (i + 1 < end && (float)misses / triangles <= acceptedAcmr)
+			{
+				clusters.push_back((std::uint32_t)(i + 1));
+				cache.Flush();
+				misses = 0;
+				triangles = 0;
+			}
+		}
+	}
+
+	return clusters.size();
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<std::uint32_t>& indices, const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& clusters, const glm::vec3& center, float threshold)
+{
+	std::size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || clusters.empty())
+	{
+		return;
+	}
+
+	std::vector<std::uint32_t> softClusters;
+	std::size_t clusterCount = BuildSoftClusters(indices, vertices.size(), clusters, threshold, softClusters);
+
+	// how much each cluster faces away from the center: those occlude the rest, so they go first
+	std::vector<float> keys(clusterCount);
+	for (std::size_t c = 0; c < clusterCount; c++)
+	{
+		std::size_t start = softClusters[c];
+		std::size_t end = c + 1 < clusterCount ? softClusters[c + 1] : triangleCount;
+
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (std::size_t i = start; i < end; i++)
+		{
+			const glm::vec3& p0 = vertices[indices[3 * i + 0]].position;
+			const glm::vec3& p1 = vertices[indices[3 * i + 1]].position;
+			const glm::vec3& p2 = vertices[indices[3 * i + 2]].position;
+
+			glm::vec3 areaNormal = glm::cross(p1 - p0, p2 - p0);
+			float triangleArea = glm::length(areaNormal);
+			centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += areaNormal;
+			area += triangleArea;
+		}
+
+		float normalLength = glm::length(normal);
+		if (area > 0.0f && normalLength > 0.0f)
+		{
+			keys[c] = glm::dot(centroid / area - center, normal / normalLength);
+		}
+		else {
+			keys[c] = 0.0f;
+		}
+	}
+
+	std::vector<std::uint32_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&keys](std::uint32_t a, std::uint32_t b) {
+		return keys[a] > keys[b];
+	});
+
+	std::vector<std::uint32_t> output;
+	output.reserve(indices.size());
+	for (std::uint32_t c : order)
+	{
+		std::size_t start = softClusters[c];
+		std::size_t end = c + 1 < clusterCount ? softClusters[c + 1] : triangleCount;
+		output.insert(output.end(), indices.begin() + 3 * start, indices.begin() + 3 * end);
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices)
+{
+	std::vector<std::uint32_t> remap(vertices.size(), IndexedMesh::NoIndex);
+	std::vector<Vertex> output;
+	output.reserve(vertices.size());
+
+	for (std::uint32_t& index : indices)
+	{
+		if (remap[index] == IndexedMesh::NoIndex)
+		{
+			remap[index] = (std::uint32_t)output.size();
+			output.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(output);
+}
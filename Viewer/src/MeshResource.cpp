@@ -0,0 +1,266 @@
+#include "MeshResource.h"
+#include "MeshOptimizer.h"
+
+MeshResource::MeshResource(MeshData&& data) :
+	mesh(std::move(data.mesh)),
+	vertices(std::move(data.vertices)),
+	normals(std::move(data.normals)),
+	textureCoords(std::move(data.textureCoords)),
+	modelVertices(std::move(data.modelVertices)),
+	modelIndices(std::move(data.modelIndices)),
+	lodIndices(std::move(data.lodIndices)),
+	lods(std::move(data.lods)),
+	indexType(modelVertices.size() <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT),
+	compactVertices(false),
+	optimized(data.optimized),
+	originalCacheStats(data.originalCacheStats),
+	mins(data.mins),
+	maxs(data.maxs),
+	avg(data.avg)
+{
+	if (lods.empty())
+	{
+		lods.push_back({ 0, (std::uint32_t)modelIndices.size() });
+	}
+	cacheStats = MeshOptimizer::AnalyzeVertexCache(modelIndices, modelVertices.size());
+
+	PopulateBoundingBoxVertices();
+	PopulateVertexNormals();
+
+	// the triangles go to GeometryBuffer the first time they are drawn, only the helpers have buffers here
+	InitOpenGL(boxVao, boxVbo, boundingBoxVertices);
+	InitOpenGL(normalVao, normalVbo, vertexNormals);
+}
+
+void MeshResource::InitOpenGL(GLVertexArray& vao, GLBuffer& vbo, const std::vector<Vertex>& vertices) {
+	//GL stuff
+	vao.Create();
+	glBindVertexArray(vao.Get());
+
+	vbo.Create();
+	glBindBuffer(GL_ARRAY_BUFFER, vbo.Get());
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+
+	// load vertex positions
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, position));
+
+	// load normals
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, normal));
+
+	// load textures
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, textureCoords));
+
+	// unbind
+	glBindVertexArray(0);
+}
+
+void MeshResource::SetCompactVertices(bool compact) {
+	// GeometryBuffer moves the mesh to the other vertex buffer before its next draw
+	compactVertices = compact;
+}
+
+bool MeshResource::HasCompactVertices() const {
+	return compactVertices;
+}
+
+std::size_t MeshResource::GetVertexSize() const {
+	return compactVertices ? sizeof(CompactVertex) : sizeof(Vertex);
+}
+
+void MeshResource::PopulateBoundingBoxVertices() {
+	Vertex ftl, ftr, fbl, fbr, btl, btr, bbl, bbr;
+	ftl.position = ftl.normal = glm::vec3(mins.x, maxs.y, mins.z);
+	ftr.position = ftr.normal = glm::vec3(maxs.x, maxs.y, mins.z);
+	fbl.position = fbl.normal = glm::vec3(mins.x, mins.y, mins.z);
+	fbr.position = fbr.normal = glm::vec3(maxs.x, mins.y, mins.z);
+	btl.position = btl.normal = glm::vec3(mins.x, maxs.y, maxs.z);
+	btr.position = btr.normal = glm::vec3(maxs.x, maxs.y, maxs.z);
+	bbl.position = bbl.normal = glm::vec3(mins.x, mins.y, maxs.z);
+	bbr.position = bbr.normal = glm::vec3(maxs.x, mins.y, maxs.z);
+	ftl.textureCoords = glm::vec2(0.0f, 0.0f);
+	ftr.textureCoords = glm::vec2(0.0f, 0.0f);
+	fbl.textureCoords = glm::vec2(0.0f, 0.0f);
+	fbr.textureCoords = glm::vec2(0.0f, 0.0f);
+	btl.textureCoords = glm::vec2(0.0f, 0.0f);
+	btr.textureCoords = glm::vec2(0.0f, 0.0f);
+	bbl.textureCoords = glm::vec2(0.0f, 0.0f);
+	bbr.textureCoords = glm::vec2(0.0f, 0.0f);
+
+	boundingBoxVertices.reserve(36);
+	boundingBoxVertices.push_back(fbl); boundingBoxVertices.push_back(fbr); boundingBoxVertices.push_back(ftr);
+	boundingBoxVertices.push_back(fbl); boundingBoxVertices.push_back(fbr); boundingBoxVertices.push_back(ftl);
+	boundingBoxVertices.push_back(fbr); boundingBoxVertices.push_back(ftr); boundingBoxVertices.push_back(bbr);
+	boundingBoxVertices.push_back(fbr); boundingBoxVertices.push_back(bbr); boundingBoxVertices.push_back(btr);
+	boundingBoxVertices.push_back(bbl); boundingBoxVertices.push_back(bbr); boundingBoxVertices.push_back(btl);
+	boundingBoxVertices.push_back(bbr); boundingBoxVertices.push_back(btl); boundingBoxVertices.push_back(btr);
+	boundingBoxVertices.push_back(fbl); boundingBoxVertices.push_back(ftl); boundingBoxVertices.push_back(bbl);
+	boundingBoxVertices.push_back(ftl); boundingBoxVertices.push_back(bbl); boundingBoxVertices.push_back(btl);
+	boundingBoxVertices.push_back(ftl); boundingBoxVertices.push_back(ftr); boundingBoxVertices.push_back(btr);
+	boundingBoxVertices.push_back(ftl); boundingBoxVertices.push_back(btl); boundingBoxVertices.push_back(btr);
+	boundingBoxVertices.push_back(fbl); boundingBoxVertices.push_back(fbr); boundingBoxVertices.push_back(bbr);
+	boundingBoxVertices.push_back(fbl); boundingBoxVertices.push_back(bbl); boundingBoxVertices.push_back(bbr);
+}
+
+void MeshResource::PopulateVertexNormals() {
+	// one line per GPU vertex, so normals from the file show up split along their seams
+	vertexNormals.reserve(2 * modelVertices.size());
+	for (const Vertex& vertex : modelVertices) {
+		Vertex start, end;
+		start.position = vertex.position;
+		start.normal = vertex.normal;
+		start.textureCoords = glm::vec2(0, 0);
+
+		end = start;
+		end.position += glm::vec3(0.1) * start.normal;
+
+		vertexNormals.push_back(start);
+		vertexNormals.push_back(end);
+	}
+}
+
+const std::vector<Vertex>& MeshResource::GetBoundingBoxVertices() const
+{
+	return boundingBoxVertices;
+}
+
+const std::vector<Vertex>& MeshResource::GetVertexNormals() const
+{
+	return vertexNormals;
+}
+
+const std::vector<glm::vec3>& MeshResource::GetVertices() const
+{
+	return vertices;
+}
+
+const std::vector<glm::vec3>& MeshResource::GetNormals() const
+{
+	return normals;
+}
+
+const std::vector<glm::vec2>& MeshResource::GetTextureCoords() const
+{
+	return textureCoords;
+}
+
+const IndexedMesh& MeshResource::GetMesh() const
+{
+	return mesh;
+}
+
+const glm::vec4& MeshResource::GetMin() const
+{
+	return mins;
+}
+
+const glm::vec4& MeshResource::GetMax() const
+{
+	return maxs;
+}
+
+const glm::vec3& MeshResource::GetAverage() const
+{
+	return avg;
+}
+
+GLuint MeshResource::GetBoundingBoxVAO() const
+{
+	return boxVao.Get();
+}
+
+GLuint MeshResource::GetVertexNormalsVAO() const
+{
+	return normalVao.Get();
+}
+
+const std::vector<Vertex>& MeshResource::GetModelVertices() const
+{
+	return modelVertices;
+}
+
+const std::vector<std::uint32_t>& MeshResource::GetModelIndices() const
+{
+	return modelIndices;
+}
+
+const std::vector<std::uint32_t>& MeshResource::GetLodIndices() const
+{
+	return lodIndices;
+}
+
+GLsizei MeshResource::GetIndexCount() const
+{
+	return (GLsizei)modelIndices.size();
+}
+
+GLenum MeshResource::GetIndexType() const
+{
+	return indexType;
+}
+
+std::size_t MeshResource::GetIndexSize() const
+{
+	return indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+}
+
+int MeshResource::GetLodCount() const
+{
+	return (int)lods.size();
+}
+
+const MeshLod& MeshResource::GetLod(int level) const
+{
+	return lods[level];
+}
+
+std::size_t MeshResource::GetVideoMemorySize() const
+{
+	std::size_t size = modelVertices.size() * GetVertexSize() + (modelIndices.size() + lodIndices.size()) * GetIndexSize();
+	return size + (boundingBoxVertices.size() + vertexNormals.size()) * sizeof(Vertex);
+}
+
+std::size_t MeshResource::GetSystemMemorySize() const
+{
+	std::size_t size = modelVertices.size() * sizeof(Vertex) + (modelIndices.size() + lodIndices.size()) * sizeof(std::uint32_t);
+
+	// the arrays the welded buffers were built from are kept too
+	size += vertices.size() * sizeof(glm::vec3) + normals.size() * sizeof(glm::vec3) + textureCoords.size() * sizeof(glm::vec2);
+	size += (mesh.positionIndices.size() + mesh.normalIndices.size() + mesh.textureIndices.size()) * sizeof(std::uint32_t);
+	size += (boundingBoxVertices.size() + vertexNormals.size()) * sizeof(Vertex);
+	if (triangleBVH)
+		size += triangleBVH->GetMemorySize();
+	return size;
+}
+
+std::size_t MeshResource::GetUnindexedMemorySize() const
+{
+	return modelIndices.size() * sizeof(Vertex);
+}
+
+bool MeshResource::IsOptimized() const
+{
+	return optimized;
+}
+
+const VertexCacheStats& MeshResource::GetCacheStats() const
+{
+	return cacheStats;
+}
+
+const VertexCacheStats& MeshResource::GetOriginalCacheStats() const
+{
+	return originalCacheStats;
+}
+
+const MeshBVH& MeshResource::GetTriangleBVH() const
+{
+	if (!triangleBVH)
+	{
+		triangleBVH.reset(new MeshBVH());
+		triangleBVH->Build(modelVertices, modelIndices);
+	}
+	return *triangleBVH;
+}
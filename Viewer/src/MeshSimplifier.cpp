@@ -0,0 +1,303 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+static std::uint64_t GetEdgeKey(std::uint32_t a, std::uint32_t b)
+{
+	return a < b ? (std::uint64_t)a << 32 | b : (std::uint64_t)b << 32 | a;
+}
+
+MeshSimplifier::MeshSimplifier(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices) :
+	vertices(vertices),
+	indices(indices),
+	positions(vertices.size()),
+	locked(vertices.size(), 0),
+	remap(vertices.size())
+{
+	const std::size_t vertexCount = vertices.size();
+	std::iota(remap.begin(), remap.end(), 0u);
+
+	// vertices at the same position end up next to each other once sorted by it; they are seams
+	std::vector<std::uint32_t> order(vertexCount);
+	std::iota(order.begin(), order.end(), 0u);
+	std::sort(order.begin(), order.end(), [&vertices](std::uint32_t a, std::uint32_t b) {
+		const glm::vec3& p = vertices[a].position;
+		const glm::vec3& q = vertices[b].position;
+		return p.x < q.x || (p.x == q.x && (p.y < q.y || (p.y == q.y && p.z < q.z)));
+	});
+	for (std::size_t i = 0; i < vertexCount; i++)
+	{
+		std::uint32_t vertex = order[i];
+		if (i > 0 && vertices[order[i - 1]].position == vertices[vertex].position)
+		{
+			positions[vertex] = positions[order[i - 1]];
+			locked[vertex] = 1;
+			locked[positions[vertex]] = 1;
+		}
+		else
+		{
+			positions[vertex] = vertex;
+		}
+	}
+
+	// an edge of one triangle is on a border, one of three or more is not manifold
+	std::vector<std::uint64_t> edges;
+	edges.reserve(indices.size());
+	for (std::size_t i = 0; i < indices.size(); i += 3)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			edges.push_back(GetEdgeKey(indices[i + corner], indices[i + (corner + 1) % 3]));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	for (std::size_t i = 0; i < edges.size();)
+	{
+		std::size_t end = i + 1;
+		while (end < edges.size() && edges[end] == edges[i])
+			end++;
+		if (end - i != 2)
+		{
+			locked[edges[i] >> 32] = 1;
+			locked[edges[i] & 0xFFFFFFFF] = 1;
+		}
+		i = end;
+	}
+
+	// every triangle's plane, weighted by its area, goes to the quadrics of its corners
+	Quadric zero = { 0 };
+	quadrics.assign(vertexCount, zero);
+	for (std::size_t i = 0; i < indices.size(); i += 3)
+	{
+		const glm::vec3& p0 = vertices[indices[i]].position;
+		glm::vec3 normal = glm::cross(vertices[indices[i + 1]].position - p0, vertices[indices[i + 2]].position - p0);
+		float length = glm::length(normal);
+		if (length == 0.0f)
+			continue;
+
+		normal /= length;
+		double distance = -glm::dot(normal, p0);
+		for (int corner = 0; corner < 3; corner++)
+		{
+			AddPlane(quadrics[positions[indices[i + corner]]], normal.x, normal.y, normal.z, distance, 0.5 * length);
+		}
+	}
+}
+
+void MeshSimplifier::AddPlane(Quadric& quadric, double a, double b, double c, double d, double weight)
+{
+	quadric.a2 += weight * a * a;
+	quadric.ab += weight * a * b;
+	quadric.ac += weight * a * c;
+	quadric.ad += weight * a * d;
+	quadric.b2 += weight * b * b;
+	quadric.bc += weight * b * c;
+	quadric.bd += weight * b * d;
+	quadric.c2 += weight * c * c;
+	quadric.cd += weight * c * d;
+	quadric.d2 += weight * d * d;
+}
+
+void MeshSimplifier::Add(Quadric& quadric, const Quadric& other)
+{
+	quadric.a2 += other.a2;
+	quadric.ab += other.ab;
+	quadric.ac += other.ac;
+	quadric.ad += other.ad;
+	quadric.b2 += other.b2;
+	quadric.bc += other.bc;
+	quadric.bd += other.bd;
+	quadric.c2 += other.c2;
+	quadric.cd += other.cd;
+	quadric.d2 += other.d2;
+}
+
+double MeshSimplifier::Evaluate(const Quadric& quadric, const glm::vec3& point)
+{
+	// the weighted sum of squared distances from point to the planes, (x y z 1) Q (x y z 1)^T
+	double x = point.x, y = point.y, z = point.z;
+	return x * x * quadric.a2 + y * y * quadric.b2 + z * z * quadric.c2 + quadric.d2 +
+		2.0 * (x * y * quadric.ab + x * z * quadric.ac + y * z * quadric.bc + x * quadric.ad + y * quadric.bd + z * quadric.cd);
+}
+
+float MeshSimplifier::GetCost(std::uint32_t from, std::uint32_t to) const
+{
+	Quadric quadric = quadrics[positions[from]];
+	Add(quadric, quadrics[positions[to]]);
+	return (float)std::max(Evaluate(quadric, vertices[to].position), 0.0);
+}
+
+bool MeshSimplifier::RunPass(std::size_t targetTriangles)
+{
+	const std::size_t vertexCount = vertices.size();
+	std::size_t triangleCount = indices.size() / 3;
+
+	std::vector<std::uint64_t> edges;
+	edges.reserve(indices.size());
+	for (std::size_t i = 0; i < indices.size(); i += 3)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			edges.push_back(GetEdgeKey(indices[i + corner], indices[i + (corner + 1) % 3]));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+	// each edge collapses in its cheaper direction, if any end may move at all
+	std::vector<Collapse> collapses;
+	collapses.reserve(edges.size());
+	for (std::uint64_t edge : edges)
+	{
+		std::uint32_t a = (std::uint32_t)(edge >> 32);
+		std::uint32_t b = (std::uint32_t)(edge & 0xFFFFFFFF);
+		if (locked[a] && locked[b])
+			continue;
+
+		Collapse collapse = { 0.0f, a, b };
+		if (locked[a] || (!locked[b] && GetCost(b, a) < GetCost(a, b)))
+		{
+			collapse.from = b;
+			collapse.to = a;
+		}
+		collapse.cost = GetCost(collapse.from, collapse.to);
+		collapses.push_back(collapse);
+	}
+	std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+		return a.cost < b.cost;
+	});
+
+	// vertex -> adjacent triangles, in one flat array
+	std::vector<std::uint32_t> offsets(vertexCount + 1, 0);
+	for (std::uint32_t index : indices)
+	{
+		offsets[index + 1]++;
+	}
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+	std::vector<std::uint32_t> adjacency(indices.size());
+	std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (std::size_t i = 0; i < indices.size(); i++)
+	{
+		adjacency[fill[indices[i]]++] = (std::uint32_t)(i / 3);
+	}
+
+	// a collapse changes the triangles around its vertex, no other collapse of this pass may touch those
+	std::vector<unsigned char> touched(vertexCount, 0);
+	bool collapsed = false;
+	for (const Collapse& collapse : collapses)
+	{
+		if (triangleCount <= targetTriangles)
+			break;
+		if (touched[collapse.from] || touched[collapse.to])
+			continue;
+
+		const glm::vec3& target = vertices[collapse.to].position;
+		std::size_t removed = 0;
+		bool flips = false;
+		for (std::uint32_t i = offsets[collapse.from]; i < offsets[collapse.from + 1] && !flips; i++)
+		{
+			const std::uint32_t* triangle = &indices[3 * adjacency[i]];
+			if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+			{
+				removed++;
+				continue;
+			}
+
+			glm::vec3 before[3], after[3];
+			for (int corner = 0; corner < 3; corner++)
+			{
+				before[corner] = vertices[triangle[corner]].position;
+				after[corner] = triangle[corner] == collapse.from ? target : before[corner];
+			}
+			glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+			// turning by more than about 75 degrees counts as a flip, that also keeps slivers out
+			flips = glm::dot(normalBefore, normalAfter) < 0.25f * glm::length(normalBefore) * glm::length(normalAfter) || glm::length(normalAfter) == 0.0f;
+		}
+		if (flips)
+			continue;
+
+		remap[collapse.from] = collapse.to;
+		Add(quadrics[positions[collapse.to]], quadrics[positions[collapse.from]]);
+		for (std::uint32_t i = offsets[collapse.from]; i < offsets[collapse.from + 1]; i++)
+		{
+			const std::uint32_t* triangle = &indices[3 * adjacency[i]];
+			touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+		}
+		triangleCount -= removed;
+		collapsed = true;
+	}
+
+	if (!collapsed)
+		return false;
+
+	// the targets of this pass did not move themselves, so one lookup is enough
+	std::size_t kept = 0;
+	for (std::size_t i = 0; i < indices.size(); i += 3)
+	{
+		std::uint32_t a = remap[indices[i]];
+		std::uint32_t b = remap[indices[i + 1]];
+		std::uint32_t c = remap[indices[i + 2]];
+		if (a == b || b == c || a == c)
+			continue;
+		indices[kept++] = a;
+		indices[kept++] = b;
+		indices[kept++] = c;
+	}
+	indices.resize(kept);
+	return true;
+}
+
+std::size_t MeshSimplifier::Simplify(std::size_t targetTriangles)
+{
+	while (indices.size() / 3 > targetTriangles && RunPass(targetTriangles))
+	{
+	}
+	return indices.size() / 3;
+}
+
+const std::vector<std::uint32_t>& MeshSimplifier::GetIndices() const
+{
+	return indices;
+}
+
+void MeshSimplifier::BuildLods(MeshData& data)
+{
+	data.lods.clear();
+	data.lodIndices.clear();
+	data.lods.push_back({ 0, (std::uint32_t)data.modelIndices.size() });
+
+	std::size_t triangles = data.modelIndices.size() / 3;
+	if (triangles / 4 < MinLodTriangles)
+	{
+		return;
+	}
+
+	MeshSimplifier simplifier(data.modelVertices, data.modelIndices);
+	for (int level = 1; level < MaxLods; level++)
+	{
+		std::size_t target = triangles / 4;
+		if (target < MinLodTriangles)
+			break;
+
+		// locked borders and seams can stop it early, a level that hardly shrinks isn't worth its memory
+		std::size_t reached = simplifier.Simplify(target);
+		if (reached > triangles * 3 / 4)
+			break;
+
+		std::vector<std::uint32_t> indices = simplifier.GetIndices();
+		if (data.optimized)
+		{
+			MeshOptimizer::OptimizeVertexCache(indices, data.modelVertices.size());
+		}
+
+		std::uint32_t first = (std::uint32_t)(data.modelIndices.size() + data.lodIndices.size());
+		data.lods.push_back({ first, (std::uint32_t)indices.size() });
+		data.lodIndices.insert(data.lodIndices.end(), indices.begin(), indices.end());
+		triangles = reached;
+	}
+}
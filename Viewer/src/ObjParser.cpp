@@ -0,0 +1,344 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+static inline bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline const char* SkipSpaces(const char* p, const char* end)
+{
+	while (p < end && IsSpace(*p))
+		p++;
+	return p;
+}
+
+static inline const char* SkipToken(const char* p, const char* end)
+{
+	while (p < end && !IsSpace(*p))
+		p++;
+	return p;
+}
+
+static inline const char* ParseFloat(const char* p, const char* end, float& value)
+{
+	p = SkipSpaces(p, end);
+
+	// from_chars doesn't accept an explicit plus sign
+	if (p < end && *p == '+')
+		p++;
+
+	std::from_chars_result result = std::from_chars(p, end, value);
+	if (result.ec != std::errc())
+	{
+		value = 0.0f;
+		return SkipToken(p, end);
+	}
+
+	return result.ptr;
+}
+
+// One polygon corner while it is being parsed: 0-based indices, or IndexedMesh::NoIndex
+struct ObjCorner
+{
+	std::uint32_t position;
+	std::uint32_t texture;
+	std::uint32_t normal;
+	unsigned char relative;
+};
+
+static inline const char* ParseIndex(const char* p, const char* end, std::size_t count, std::uint32_t& index, unsigned char& relative, unsigned char relativeBit)
+{
+	int value = 0;
+	std::from_chars_result result = std::from_chars(p, end, value);
+	if (result.ec != std::errc() || value == 0)
+	{
+		index = IndexedMesh::NoIndex;
+		return result.ptr;
+	}
+
+	if (value > 0)
+	{
+		index = (std::uint32_t)(value - 1);
+	}
+	else
+	{
+		// negative indices are relative to the last element read so far.
+		// count is local to the chunk being parsed, so the index is marked for the merge to fix up
+		// (the unsigned arithmetic wraps around and comes out right once the chunk offset is added).
+		index = (std::uint32_t)count + (std::uint32_t)value;
+		relative |= relativeBit;
+	}
+
+	return result.ptr;
+}
+
+static inline const char* ParseCorner(const char* p, const char* end, const ObjData& data, ObjCorner& corner)
+{
+	corner.texture = IndexedMesh::NoIndex;
+	corner.normal = IndexedMesh::NoIndex;
+	corner.relative = 0;
+
+	const char* next = ParseIndex(p, end, data.vertices.size(), corner.position, corner.relative, ObjData::RELATIVE_POSITION);
+	if (next == p)
+		return p;
+	p = next;
+
+	if (p < end && *p == '/')
+	{
+		p++;
+
+		if (p < end && *p != '/')
+			p = ParseIndex(p, end, data.textureCoords.size(), corner.texture, corner.relative, ObjData::RELATIVE_TEXTURE);
+
+		if (p < end && *p == '/')
+		{
+			p++;
+			p = ParseIndex(p, end, data.normals.size(), corner.normal, corner.relative, ObjData::RELATIVE_NORMAL);
+		}
+	}
+
+	return p;
+}
+
+static inline void AddCorner(const ObjCorner& corner, ObjData& data)
+{
+	data.mesh.positionIndices.push_back(corner.position);
+	data.mesh.textureIndices.push_back(corner.texture);
+	data.mesh.normalIndices.push_back(corner.normal);
+	data.relativeCorners.push_back(corner.relative);
+}
+
+static const char* ParseFace(const char* p, const char* end, ObjData& data)
+{
+	// polygons are fan-triangulated around their first corner as they are read: (0, 1, 2), (0, 2, 3), ...
+	ObjCorner first, previous, current;
+	int cornerCount = 0;
+
+	while (true)
+	{
+		p = SkipSpaces(p, end);
+
+		const char* next = ParseCorner(p, end, data, current);
+		if (next == p)
+			break;
+		p = next;
+
+		if (cornerCount == 0)
+		{
+			first = current;
+		}
+		else if (cornerCount >= 2)
+		{
+			AddCorner(first, data);
+			AddCorner(previous, data);
+			AddCorner(current, data);
+		}
+
+		previous = current;
+		cornerCount++;
+	}
+
+	return p;
+}
+
+static void ParseLine(const char* p, const char* end, ObjData& data)
+{
+	p = SkipSpaces(p, end);
+	const char* typeEnd = SkipToken(p, end);
+	std::size_t typeLength = typeEnd - p;
+
+	// based on the type parse data
+	if (typeLength == 1 && p[0] == 'v')
+	{
+		glm::vec3 v;
+		p = ParseFloat(typeEnd, end, v.x);
+		p = ParseFloat(p, end, v.y);
+		p = ParseFloat(p, end, v.z);
+		data.vertices.push_back(v);
+	}
+	else if (typeLength == 2 && p[0] == 'v' && p[1] == 'n')
+	{
+		glm::vec3 n;
+		p = ParseFloat(typeEnd, end, n.x);
+		p = ParseFloat(p, end, n.y);
+		p = ParseFloat(p, end, n.z);
+		data.normals.push_back(n);
+	}
+	else if (typeLength == 2 && p[0] == 'v' && p[1] == 't')
+	{
+		glm::vec2 t;
+		p = ParseFloat(typeEnd, end, t.x);
+		p = ParseFloat(p, end, t.y);
+		data.textureCoords.push_back(t);
+	}
+	else if (typeLength == 1 && p[0] == 'f')
+	{
+		ParseFace(typeEnd, end, data);
+	}
+	else
+	{
+		// comment / empty line / unsupported statement
+	}
+}
+
+void ObjParser::ParseChunk(const char* begin, const char* end, ObjData& data, LoadProgress* progress)
+{
+	const char* lineStart = begin;
+	const char* reported = begin;
+	while (lineStart < end)
+	{
+		const char* lineEnd = static_cast<const char*>(std::memchr(lineStart, '\n', end - lineStart));
+		if (lineEnd == nullptr)
+			lineEnd = end;
+
+		ParseLine(lineStart, lineEnd, data);
+		lineStart = lineEnd + 1;
+
+		if (progress != nullptr && (std::size_t)(lineStart - reported) >= ProgressInterval)
+		{
+			progress->AddParsedBytes(lineStart - reported);
+			reported = lineStart;
+
+			if (progress->IsCancelled())
+				return;
+		}
+	}
+
+	if (progress != nullptr)
+		progress->AddParsedBytes(std::min(lineStart, end) - reported);
+}
+
+void ObjParser::ParseBuffer(const char* begin, const char* end, ObjData& data, unsigned int threadCount, LoadProgress* progress)
+{
+	std::size_t size = end - begin;
+
+	// don't bother spinning threads up for small files
+	unsigned int chunkCount = GetParallelRangeCount(size, MinChunkSize, threadCount);
+	if (progress != nullptr)
+		progress->StartParsing(size);
+
+	if (chunkCount == 1)
+	{
+		ParseChunk(begin, end, data, progress);
+		DropInvalidIndices(data);
+		return;
+	}
+
+	// split into chunks that start right after a newline
+	std::vector<const char*> bounds(chunkCount + 1);
+	bounds[0] = begin;
+	bounds[chunkCount] = end;
+	for (unsigned int i = 1; i < chunkCount; i++)
+	{
+		const char* p = std::max(begin + size * i / chunkCount, bounds[i - 1]);
+		const char* newLine = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		bounds[i] = newLine != nullptr ? newLine + 1 : end;
+	}
+
+	std::vector<ObjData> chunks(chunkCount);
+	RunParallel(chunkCount, [&](unsigned int i) {
+		ParseChunk(bounds[i], bounds[i + 1], chunks[i], progress);
+	});
+
+	if (progress != nullptr && progress->IsCancelled())
+		return;
+
+	MergeChunks(chunks, data);
+	DropInvalidIndices(data);
+}
+
+void ObjParser::MergeChunks(std::vector<ObjData>& chunks, ObjData& data)
+{
+	std::size_t chunkCount = chunks.size();
+
+	// exclusive prefix sums of the element counts give every chunk its place in the merged streams
+	std::vector<std::size_t> vertexOffsets(chunkCount + 1, data.vertices.size());
+	std::vector<std::size_t> normalOffsets(chunkCount + 1, data.normals.size());
+	std::vector<std::size_t> textureOffsets(chunkCount + 1, data.textureCoords.size());
+	std::vector<std::size_t> cornerOffsets(chunkCount + 1, data.mesh.GetCornerCount());
+	for (std::size_t i = 0; i < chunkCount; i++)
+	{
+		vertexOffsets[i + 1] = vertexOffsets[i] + chunks[i].vertices.size();
+		normalOffsets[i + 1] = normalOffsets[i] + chunks[i].normals.size();
+		textureOffsets[i + 1] = textureOffsets[i] + chunks[i].textureCoords.size();
+		cornerOffsets[i + 1] = cornerOffsets[i] + chunks[i].mesh.GetCornerCount();
+	}
+
+	data.vertices.resize(vertexOffsets[chunkCount]);
+	data.normals.resize(normalOffsets[chunkCount]);
+	data.textureCoords.resize(textureOffsets[chunkCount]);
+	data.mesh.positionIndices.resize(cornerOffsets[chunkCount]);
+	data.mesh.textureIndices.resize(cornerOffsets[chunkCount]);
+	data.mesh.normalIndices.resize(cornerOffsets[chunkCount]);
+
+	RunParallel((unsigned int)chunkCount, [&](unsigned int i) {
+		ObjData& chunk = chunks[i];
+		std::copy(chunk.vertices.begin(), chunk.vertices.end(), data.vertices.begin() + vertexOffsets[i]);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), data.normals.begin() + normalOffsets[i]);
+		std::copy(chunk.textureCoords.begin(), chunk.textureCoords.end(), data.textureCoords.begin() + textureOffsets[i]);
+
+		// relative indices were resolved against the chunk's own counts; shift them by what came before
+		std::uint32_t vertexOffset = (std::uint32_t)vertexOffsets[i];
+		std::uint32_t normalOffset = (std::uint32_t)normalOffsets[i];
+		std::uint32_t textureOffset = (std::uint32_t)textureOffsets[i];
+		std::uint32_t* positionIndices = data.mesh.positionIndices.data() + cornerOffsets[i];
+		std::uint32_t* textureIndices = data.mesh.textureIndices.data() + cornerOffsets[i];
+		std::uint32_t* normalIndices = data.mesh.normalIndices.data() + cornerOffsets[i];
+		for (std::size_t j = 0; j < chunk.mesh.GetCornerCount(); j++)
+		{
+			unsigned char relative = chunk.relativeCorners[j];
+			positionIndices[j] = chunk.mesh.positionIndices[j] + ((relative & ObjData::RELATIVE_POSITION) ? vertexOffset : 0);
+			textureIndices[j] = chunk.mesh.textureIndices[j] + ((relative & ObjData::RELATIVE_TEXTURE) ? textureOffset : 0);
+			normalIndices[j] = chunk.mesh.normalIndices[j] + ((relative & ObjData::RELATIVE_NORMAL) ? normalOffset : 0);
+		}
+	});
+}
+
+void ObjParser::DropInvalidIndices(ObjData& data)
+{
+	// every index is resolved now, the relative marks are of no more use
+	data.relativeCorners = std::vector<unsigned char>();
+
+	// a corner without a valid position (index 0, or past either end) takes its triangle with it.
+	// A texture coordinate or normal out of range only goes missing, like one that isn't given
+	IndexedMesh& mesh = data.mesh;
+	std::size_t kept = 0;
+	for (std::size_t i = 0; i + 2 < mesh.GetCornerCount(); i += 3)
+	{
+		if (mesh.positionIndices[i] >= data.vertices.size() ||
+			mesh.positionIndices[i + 1] >= data.vertices.size() ||
+			mesh.positionIndices[i + 2] >= data.vertices.size())
+		{
+			continue;
+		}
+
+		for (std::size_t j = 0; j < 3; j++)
+		{
+			mesh.positionIndices[kept + j] = mesh.positionIndices[i + j];
+			mesh.textureIndices[kept + j] = mesh.textureIndices[i + j] < data.textureCoords.size() ? mesh.textureIndices[i + j] : IndexedMesh::NoIndex;
+			mesh.normalIndices[kept + j] = mesh.normalIndices[i + j] < data.normals.size() ? mesh.normalIndices[i + j] : IndexedMesh::NoIndex;
+		}
+		kept += 3;
+	}
+
+	mesh.positionIndices.resize(kept);
+	mesh.textureIndices.resize(kept);
+	mesh.normalIndices.resize(kept);
+}
+
+bool ObjParser::ParseFile(const std::string& filePath, ObjData& data, unsigned int threadCount, LoadProgress* progress)
+{
+	MappedFile file(filePath);
+	if (!file.IsOpen())
+	{
+		return false;
+	}
+
+	ParseBuffer(file.GetData(), file.GetData() + file.GetSize(), data, threadCount, progress);
+	return true;
+}
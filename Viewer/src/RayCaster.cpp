@@ -0,0 +1,27 @@
+#include "RayCaster.h"
+
+Ray RayCaster::FromCursor(const CameraState& camera, const glm::vec2& cursor, const glm::vec2& viewportSize)
+{
+	// window y grows downwards, normalized device y upwards
+	glm::vec2 ndc(2.0f * cursor.x / viewportSize.x - 1.0f, 1.0f - 2.0f * cursor.y / viewportSize.y);
+	glm::mat4 inverse = glm::inverse(camera.projection * camera.view * camera.world);
+
+	glm::vec4 nearPoint = inverse * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+	glm::vec4 farPoint = inverse * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+	nearPoint /= nearPoint.w;
+	farPoint /= farPoint.w;
+
+	Ray ray;
+	ray.origin = glm::vec3(nearPoint);
+	ray.direction = glm::vec3(farPoint) - glm::vec3(nearPoint);
+	return ray;
+}
+
+Ray RayCaster::ToLocal(const Ray& ray, const glm::mat4& transform)
+{
+	glm::mat4 inverse = glm::inverse(transform);
+	Ray local;
+	local.origin = glm::vec3(inverse * glm::vec4(ray.origin, 1.0f));
+	local.direction = glm::vec3(inverse * glm::vec4(ray.direction, 0.0f));
+	return local;
+}
@@ -0,0 +1,112 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstring>
+
+GLuint RenderQueue::GetVAO(const MeshModel& model, RenderPass pass)
+{
+	switch (pass)
+	{
+	case PASS_BOX:
+	case PASS_OCCLUSION:
+		return model.GetBoundingBoxVAO();
+	case PASS_NORMALS:
+		return model.GetVertexNormalsVAO();
+	default:
+		return 0;
+	}
+}
+
+std::uint32_t RenderQueue::GetGeometryId(const MeshModel& model, RenderPass pass)
+{
+	GLuint vao = GetVAO(model, pass);
+	if (vao != 0)
+	{
+		return vao;
+	}
+
+	// GeometryBuffer has a VAO per vertex format and index type, those come first; then the mesh
+	const MeshResource& mesh = *model.GetMeshResource();
+	std::uint32_t shared = (mesh.HasCompactVertices() ? 2 : 0) | (mesh.GetIndexType() == GL_UNSIGNED_INT ? 1 : 0);
+	std::uint64_t address = (std::uintptr_t)&mesh;
+	std::uint32_t hash = (std::uint32_t)((address >> 4) ^ (address >> 16) ^ (address >> 32));
+	return shared << 12 | (hash & 0xFFF);
+}
+
+std::uint32_t RenderQueue::GetMaterialId(const MeshModel& model)
+{
+	// the texture projection is a material property too, while there is a texture to project
+	float material[5] = { model.Ka, model.Kd, model.Ks, (float)model.alpha, model.useTexture ? (float)model.textureProjection : 0.0f };
+	std::uint32_t words[5];
+	std::memcpy(words, material, sizeof(material));
+
+	std::uint32_t hash = 2166136261u;
+	for (std::uint32_t word : words)
+	{
+		hash = (hash ^ word) * 16777619u;
+	}
+	return hash ^ (hash >> 16);
+}
+
+std::uint64_t RenderQueue::GetDepthBits(float depth)
+{
+	// non negative floats order the same as their bit patterns, the top 13 bits are precise enough
+	depth = std::max(depth, 0.0f);
+	std::uint32_t bits;
+	std::memcpy(&bits, &depth, sizeof(bits));
+	return bits >> 19;
+}
+
+std::uint64_t RenderQueue::MakeKey(RenderPass pass, GLuint program, GLuint texture, std::uint32_t material, std::uint32_t geometry, int lod, float depth)
+{
+	return ((std::uint64_t)pass & 0x7) << 61 |
+		((std::uint64_t)program & 0x1F) << 56 |
+		((std::uint64_t)texture & 0x3FFF) << 42 |
+		((std::uint64_t)material & 0xFFF) << 30 |
+		((std::uint64_t)geometry & 0x3FFF) << 16 |
+		((std::uint64_t)lod & 0x7) << 13 |
+		GetDepthBits(depth);
+}
+
+void RenderQueue::Clear()
+{
+	items.clear();
+	order.clear();
+}
+
+void RenderQueue::Add(RenderPass pass, const MeshModel* model, const glm::mat4& transform, float depth, GLuint program)
+{
+	GLuint texture = 0;
+	if (pass == PASS_FILL && model->useTexture && model->GetTexture())
+	{
+		texture = model->GetTexture()->getHandle();
+	}
+
+	// only the passes drawing the model's own triangles use its level of detail
+	int lod = pass == PASS_FILL || pass == PASS_WIRE ? model->lodLevel : 0;
+	std::uint64_t key = MakeKey(pass, program, texture, GetMaterialId(*model), GetGeometryId(*model, pass), lod, depth);
+	items.push_back({ key, pass, model, transform });
+}
+
+void RenderQueue::Sort()
+{
+	// sorts 16 byte entries instead of moving the items and their matrices around
+	order.resize(items.size());
+	for (std::size_t i = 0; i < items.size(); i++)
+	{
+		order[i] = { items[i].key, (std::uint32_t)i };
+	}
+
+	std::sort(order.begin(), order.end(), [](const SortEntry& a, const SortEntry& b) {
+		return a.key < b.key || (a.key == b.key && a.index < b.index);
+	});
+}
+
+std::size_t RenderQueue::GetCount() const
+{
+	return order.size();
+}
+
+const RenderQueue::Item& RenderQueue::GetSorted(std::size_t i) const
+{
+	return items[order[i].index];
+}
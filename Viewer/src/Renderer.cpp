@@ -4,20 +4,42 @@
 #include "InitShader.h"
 #include "MeshModel.h"
 #include "Utils.h"
+#include "VertexQuantizer.h"
 #include <iostream>
 #include <imgui/imgui.h>
 #include <vector>
 #include <cmath>
 #include <math.h>
 #include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <chrono>
 
 #define FLAT 0
 #define GOURAUD 1
 #define PHONG 2
 
 Renderer::Renderer() :
+	objectCount(0),
+	instancesOffset(0),
+	multiDrawSupported(false),
+	submitMs(),
+	drawCalls(0),
+	stateChanges(0),
+	visibleCount(0),
+	culledCount(0),
+	bvhRebuilds(0),
+	occlusionTarget(GL_SAMPLES_PASSED),
+	frameIndex(0),
+	conditionalDraws(0),
+	occludedDraws(0),
+	triangleCount(0),
 	fogActivated(false),
-	fogColor(0.343f, 0.105f, 0.667f)
+	fogColor(0.343f, 0.105f, 0.667f),
+	frustumCulling(true),
+	occlusionCulling(true),
+	levelOfDetail(true),
+	submitMode(SUBMIT_MULTI_DRAW)
 {
 
 }
@@ -27,119 +49,653 @@ Renderer::~Renderer()
 
 }
 
-void Renderer::DrawModel(const Scene& scene, MeshModel* model) {
-	glm::mat4 modelMat = scene.GetWorldTransformation() * model->GetWorldTransformation();
+//-----------------------------------------------------------------------------
+// Items drawn in one batch have to agree on everything but their transformation and color
+//-----------------------------------------------------------------------------
+static bool SameBatch(const RenderQueue::Item& item, RenderPass pass, const MeshModel& model)
+{
+	const MeshModel& other = *item.model;
+	if (item.pass != pass || other.GetMeshResource() != model.GetMeshResource())
+		return false;
+	if (other.Ka != model.Ka || other.Kd != model.Kd || other.Ks != model.Ks || other.alpha != model.alpha)
+		return false;
+	if (pass == PASS_FILL && (other.useTexture != model.useTexture || (model.useTexture && other.GetTexture() != model.GetTexture())))
+		return false;
+	if (pass == PASS_FILL && model.useTexture && other.textureProjection != model.textureProjection)
+		return false;
+	if ((pass == PASS_FILL || pass == PASS_WIRE) && other.lodLevel != model.lodLevel)
+		return false;
+	return true;
+}
 
-	// Set the uniform variables
-	colorShader.setUniform("model", modelMat);
-	colorShader.setUniform("material.color", model->color);
-	colorShader.setUniform("material.Ka", model->Ka);
-	colorShader.setUniform("material.Kd", model->Kd);
-	colorShader.setUniform("material.Ks", model->Ks);
-	colorShader.setUniform("material.alpha", model->alpha);
-	colorShader.setUniform("useTexture", model->useTexture);
+//-----------------------------------------------------------------------------
+// The level of detail for a model whose world space box is box. A level is right while the box looks
+// about as much smaller than the screen as the level has fewer triangles than the full mesh, by area,
+// so the triangles stay about as big on screen. The bounds of the current level are widened a bit,
+// so a model near one doesn't switch back and forth every frame.
+//-----------------------------------------------------------------------------
+static int SelectLod(const MeshModel& model, const AABB& box, const glm::mat4& view, const glm::mat4& projection)
+{
+	const float Hysteresis = 0.15f;
 
-	if (model->fill) {
-		// Set the model's texture as the active texture at slot #0
-		model->BindTexture();
+	int count = model.GetLodCount();
+	int level = std::min(std::max(model.lodLevel, 0), count - 1);
+	if (count <= 1)
+		return level;
+
+	// the bounding sphere's radius over the half height of the view, perspective divides by the distance
+	float radius = glm::length(box.GetExtent());
+	float size = radius * projection[1][1];
+	if (projection[2][3] != 0.0f) {
+		float distance = -(view * glm::vec4(box.GetCenter(), 1.0f)).z;
+		size /= std::max(distance, radius);
+	}
+
+	// level l is used below the size sqrt(triangles of l / triangles of 0)
+	float fullCount = (float)model.GetLod(0).indexCount;
+	while (level + 1 < count && size < std::sqrt(model.GetLod(level + 1).indexCount / fullCount) * (1.0f - Hysteresis))
+		level++;
+	while (level > 0 && size > std::sqrt(model.GetLod(level).indexCount / fullCount) * (1.0f + Hysteresis))
+		level--;
+	return level;
+}
+
+static glm::vec4 GetPassColor(RenderPass pass, const MeshModel& model)
+{
+	switch (pass)
+	{
+	case PASS_WIRE:
+		return glm::vec4(0, 0, 1, 1);
+	case PASS_BOX:
+		return glm::vec4(1, 0, 0, 1);
+	case PASS_NORMALS:
+		return glm::vec4(0, 1, 0, 1);
+	default:
+		return model.color;
+	}
+}
+
+// the texture a pass of the model binds, if any
+static const Texture2D* GetPassTexture(RenderPass pass, const MeshModel& model)
+{
+	return pass == PASS_FILL && model.useTexture ? model.GetTexture().get() : nullptr;
+}
+
+static ObjectData GetObjectData(RenderPass pass, const MeshModel& model)
+{
+	ObjectData data;
+	std::memset(&data, 0, sizeof(data));
+	data.Ka = model.Ka;
+	data.Kd = model.Kd;
+	data.Ks = model.Ks;
+	data.alpha = model.alpha;
+	data.useTexture = pass == PASS_FILL && model.useTexture && model.GetTexture();
+	data.textureProjection = data.useTexture ? model.textureProjection : ORIGINAL;
+
+	// only the main VAO can hold compact vertices, the helper geometry is always plain Vertex
+	data.compactVertices = (pass == PASS_FILL || pass == PASS_WIRE) && model.HasCompactVertices();
+	if (data.compactVertices) {
+		glm::vec3 mins(model.GetMin());
+		data.positionMin = glm::vec4(mins, 0);
+		data.positionExtent = glm::vec4(VertexQuantizer::GetExtent(mins, glm::vec3(model.GetMax())), 0);
+	}
+	return data;
+}
+
+void Renderer::CollectModel(const Scene& scene, MeshModel* model) {
+	model->SetWorldTransformation();
+	glm::mat4 transform = scene.GetWorldTransformation() * model->GetWorldTransformation();
+	candidates.push_back({ model, transform });
+	candidateBoxes.push_back(AABB(glm::vec3(model->GetMin()), glm::vec3(model->GetMax())).Transform(transform));
+}
+
+void Renderer::UpdateSceneBVH() {
+	bool sameObjects = bvhModels.size() == candidates.size();
+	for (std::size_t i = 0; i < candidates.size() && sameObjects; i++) {
+		sameObjects = bvhModels[i] == candidates[i].model;
+	}
+
+	// objects that only moved are refitted, until that made the tree too slow
+	if (sameObjects) {
+		for (std::size_t i = 0; i < candidates.size(); i++) {
+			sceneBVH.SetBox((std::uint32_t)i, candidateBoxes[i]);
+		}
+		if (sceneBVH.Refit() == 0 || !sceneBVH.NeedsRebuild())
+			return;
+	}
+
+	bvhModels.resize(candidates.size());
+	for (std::size_t i = 0; i < candidates.size(); i++) {
+		bvhModels[i] = candidates[i].model;
+	}
+	sceneBVH.Build(candidateBoxes);
+	bvhRebuilds++;
+}
+
+void Renderer::QueueModel(const glm::mat4& view, MeshModel* model, const glm::mat4& transform) {
+	float depth = -(view * transform[3]).z;
+	GLuint program = colorShader.getProgram();
+
+	if (model->fill)
+		renderQueue.Add(PASS_FILL, model, transform, depth, program);
+
+	// wire frames, bounding boxes and normals are drawn after every filled model
+	if (model->showWire)
+		renderQueue.Add(PASS_WIRE, model, transform, depth, program);
+	if (model->showBoundingBox)
+		renderQueue.Add(PASS_BOX, model, transform, depth, program);
+	if (model->showVertexNormals)
+		renderQueue.Add(PASS_NORMALS, model, transform, depth, program);
+}
+
+void Renderer::BindInstances(std::size_t first) {
+	glBindBuffer(GL_ARRAY_BUFFER, streamBuffer.GetBuffer());
+
+	const GLsizei stride = sizeof(InstanceData);
+	const std::size_t offset = instancesOffset + first * sizeof(InstanceData);
+	for (GLuint column = 0; column < 4; column++) {
+		GLuint location = InstanceModelLocation + column;
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offset + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(location, 1);
+	}
+
+	glEnableVertexAttribArray(InstanceColorLocation);
+	glVertexAttribPointer(InstanceColorLocation, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offset + offsetof(InstanceData, color)));
+	glVertexAttribDivisor(InstanceColorLocation, 1);
+}
+
+//-----------------------------------------------------------------------------
+// Turns the sorted queue into batches: items next to each other that share a pass, a mesh and a
+// material are instances of one draw call. Their model matrices and colors go to the StreamBuffer as
+// per instance attributes of vshader.glsl, and every distinct material gets one ObjectData block there,
+// so switching materials between draws is a single glBindBufferRange.
+//-----------------------------------------------------------------------------
+void Renderer::BuildBatches() {
+	sharedGeometry.Collect();
 
-		// Drag our model's faces (triangles) in fill mode
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-		glBindVertexArray(model->GetVAO());
-		glDrawArrays(GL_TRIANGLES, 0, (GLsizei)model->GetModelVertices().size());
-		glBindVertexArray(0);
+	// the queue is sorted, so items that can share a draw call are next to each other
+	for (std::size_t i = 0; i < renderQueue.GetCount(); i++) {
+		const RenderQueue::Item& item = renderQueue.GetSorted(i);
 
-		// Unset the model's texture as the active texture at slot #0
-		model->UnbindTexture();
+		bool sameBatch = !batches.empty() && SameBatch(item, batches.back().pass, *batches.back().model);
+		if (!sameBatch) {
+			// the helper geometry is a few vertices per model, it stays in the models' own VAOs
+			const GeometryBuffer::Allocation* geometry = nullptr;
+			if (item.pass == PASS_FILL || item.pass == PASS_WIRE)
+				geometry = sharedGeometry.Find(item.model->GetMeshResource());
+			batches.push_back({ item.pass, item.model, instances.size(), 0, AddObjectData(item.pass, *item.model), 0, geometry, 14695981039346656037ull });
+		}
+
+		Batch& batch = batches.back();
+		batch.count++;
+		if (batch.pass == PASS_FILL && batch.members != 0)
+			batch.members = closeModels.count(item.model) != 0 ? 0 : (batch.members ^ (std::uintptr_t)item.model) * 1099511628211ull;
+		instances.push_back({ item.transform, GetPassColor(item.pass, *item.model) });
 	}
 
-	colorShader.setUniform("useTexture", false);
-	
-	if (model->showWire) {
-		colorShader.setUniform("material.color", glm::vec4(0, 0, 1, 1));
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-		glBindVertexArray(model->GetVAO());
-		glDrawArrays(GL_TRIANGLES, 0, (GLsizei)model->GetModelVertices().size());
-		glBindVertexArray(0);
+	if (occlusionCulling)
+		AddOcclusionBatches();
+
+	// a query no run got this frame would be stale by the time it is drawn on again
+	for (std::unordered_map<const MeshModel*, OcclusionQuery>::iterator occlusion = occlusionQueries.begin(); occlusion != occlusionQueries.end();) {
+		if (occlusion->second.frame != frameIndex)
+			occlusion = occlusionQueries.erase(occlusion);
+		else
+			++occlusion;
 	}
+}
 
-	if (model->showBoundingBox) {
-		colorShader.setUniform("material.color", glm::vec4(1, 0, 0, 1));
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-		glBindVertexArray(model->boxVao);
-		glDrawArrays(GL_TRIANGLES, 0, (GLsizei)model->GetBoundingBoxVertices().size());
-		glBindVertexArray(0);
+std::size_t Renderer::AddObjectData(RenderPass pass, const MeshModel& model) {
+	// consecutive batches often only differ in their mesh, those share one block
+	const std::size_t stride = streamBuffer.Align(sizeof(ObjectData));
+	ObjectData data = GetObjectData(pass, model);
+	if (objectCount == 0 || std::memcmp(&objectBlocks[(objectCount - 1) * stride], &data, sizeof(data)) != 0) {
+		objectBlocks.resize((objectCount + 1) * stride);
+		std::memcpy(&objectBlocks[objectCount * stride], &data, sizeof(data));
+		objectCount++;
 	}
+	return objectCount - 1;
+}
+
+bool Renderer::JoinsMultiDraw(const Batch& batch, const Batch& next) const {
+	return submitMode == SUBMIT_MULTI_DRAW && batch.geometry && next.geometry && sharedGeometry.GetVAO(*next.geometry) == sharedGeometry.GetVAO(*batch.geometry) &&
+		next.pass == batch.pass && next.object == batch.object && next.query == batch.query &&
+		GetPassTexture(next.pass, *next.model) == GetPassTexture(batch.pass, *batch.model);
+}
+
+//-----------------------------------------------------------------------------
+// Occlusion culling: the bounding boxes of a run's instances are drawn last inside its query, without
+// writing color or depth. The next frame draws the run under a conditional render on that query, so
+// the GPU skips it if none of its boxes was visible, and the CPU never waits for a result.
+//-----------------------------------------------------------------------------
+void Renderer::AddOcclusionBatches() {
+	// the fill batches come first. Each run of them drawn in one go, one batch or those joining one
+	// multi-draw, gets one query over the union of its instances' boxes, so it stays one draw call
+	const std::size_t batchCount = batches.size();
+	for (std::size_t i = 0; i < batchCount && batches[i].pass == PASS_FILL;) {
+		std::size_t end = i + 1;
+		while (end < batchCount && JoinsMultiDraw(batches[i], batches[end]))
+			end++;
 
-	if (model->showVertexNormals) {
-		colorShader.setUniform("material.color", glm::vec4(0, 1, 0, 1));
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-		glBindVertexArray(model->normalVao);
-		glDrawArrays(GL_LINES, 0, (GLsizei)model->GetVertexNormals().size());
-		glBindVertexArray(0);
+		std::uint64_t members = 14695981039346656037ull;
+		for (std::size_t j = i; j < end && members != 0; j++)
+			members = batches[j].members == 0 ? 0 : (members ^ batches[j].members) * 1099511628211ull;
+		if (members == 0) {
+			i = end;
+			continue;
+		}
+
+		// last frame's result only stands for the same models, a run that changed is drawn unconditionally once
+		OcclusionQuery& occlusion = occlusionQueries[batches[i].model];
+		if (occlusion.query.Get() == 0)
+			occlusion.query.Create();
+		GLuint query = occlusion.query.Get();
+		bool hasResult = occlusion.members == members;
+		occlusion.members = members;
+		occlusion.frame = frameIndex;
+
+		for (std::size_t j = i; j < end; j++) {
+			if (hasResult)
+				batches[j].query = query;
+			// the boxes are drawn as instances of the fill batch's own instances
+			Batch box = { PASS_OCCLUSION, batches[j].model, batches[j].first, batches[j].count, AddObjectData(PASS_OCCLUSION, *batches[j].model), query, nullptr, 0 };
+			batches.push_back(box);
+		}
+		i = end;
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Draws the batches in order, skipping every redundant state change. With GL 4.3 each run of batches
+// that only differ in their mesh is one glMultiDrawElementsIndirect, the base instance of a command
+// pointing it at its batch's instances. Without it every batch is a glDrawElementsInstancedBaseVertex
+// in the same shared VAO: glMultiDrawElements can't give its draws instances of their own.
+//-----------------------------------------------------------------------------
+void Renderer::SubmitBatches() {
+	if (instances.empty())
+		return;
+
+	// the commands of every batch in the shared buffer, in batch order
+	commands.clear();
+	if (submitMode == SUBMIT_MULTI_DRAW) {
+		for (const Batch& batch : batches) {
+			if (batch.geometry == nullptr)
+				continue;
+			const MeshLod& lod = batch.model->GetLod(batch.model->lodLevel);
+			commands.push_back({ lod.indexCount, (GLuint)batch.count, batch.geometry->firstIndex + lod.firstIndex, batch.geometry->baseVertex, (GLuint)batch.first });
+		}
+	}
+
+	// the FrameData block, the instances, every ObjectData block and the commands go up in one write each,
+	// into the same buffer; reserved together, so a new buffer can't come between them
+	const std::size_t stride = streamBuffer.Align(sizeof(ObjectData));
+	const std::size_t instancesSize = instances.size() * sizeof(InstanceData);
+	const std::size_t commandsSize = commands.size() * sizeof(DrawCommand);
+	streamBuffer.Reserve(streamBuffer.Align(sizeof(FrameData)) + streamBuffer.Align(instancesSize) + objectCount * stride + streamBuffer.Align(commandsSize));
+	streamBuffer.Bind(FrameDataBinding, streamBuffer.Write(&frameData, sizeof(frameData)), sizeof(frameData));
+	instancesOffset = streamBuffer.Write(instances.data(), instancesSize);
+	const std::size_t objectsOffset = streamBuffer.Write(objectBlocks.data(), objectCount * stride);
+	std::size_t commandsOffset = 0;
+	if (!commands.empty()) {
+		commandsOffset = streamBuffer.Write(commands.data(), commandsSize);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, streamBuffer.GetBuffer());
+	}
+
+	// what is set right now; a null pointer / GL_NONE / -1 means not set yet this frame
+	GLenum polygonMode = GL_NONE;
+	GLuint vao = 0;
+	const Texture2D* texture = nullptr;
+	std::size_t object = (std::size_t)-1;
+	bool occlusionPass = false;
+	std::size_t sharedFirst = (std::size_t)-1;	// the first instance the bound shared VAO's instance attributes read
+	std::size_t command = 0;
+
+	for (std::size_t i = 0; i < batches.size();) {
+		const Batch& batch = batches[i];
+		const MeshModel& model = *batch.model;
+
+		// occlusion batches sort last, once they start only the queries write anything
+		if (batch.pass == PASS_OCCLUSION && !occlusionPass) {
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			glDepthMask(GL_FALSE);
+			glDepthFunc(GL_LEQUAL);
+			occlusionPass = true;
+			stateChanges++;
+		}
+
+		GLenum batchPolygonMode = batch.pass == PASS_FILL || batch.pass == PASS_OCCLUSION ? GL_FILL : GL_LINE;
+		if (batchPolygonMode != polygonMode) {
+			glPolygonMode(GL_FRONT_AND_BACK, batchPolygonMode);
+			polygonMode = batchPolygonMode;
+			stateChanges++;
+		}
+
+		if (batch.object != object) {
+			streamBuffer.Bind(ObjectDataBinding, objectsOffset + batch.object * stride, sizeof(ObjectData));
+			object = batch.object;
+			stateChanges++;
+		}
+
+		// Set the model's texture as the active texture at slot #0
+		const Texture2D* batchTexture = GetPassTexture(batch.pass, model);
+		if (batchTexture != nullptr && batchTexture != texture) {
+			model.BindTexture();
+			texture = batchTexture;
+			stateChanges++;
+		}
+
+		// SUBMIT_LOOP draws every mesh from a VAO of its own, the way it was before GeometryBuffer
+		GLuint batchVao = RenderQueue::GetVAO(model, batch.pass);
+		if (batch.geometry)
+			batchVao = submitMode == SUBMIT_LOOP ? sharedGeometry.GetMeshVAO(*model.GetMeshResource()) : sharedGeometry.GetVAO(*batch.geometry);
+		if (batchVao != vao) {
+			glBindVertexArray(batchVao);
+			vao = batchVao;
+			sharedFirst = (std::size_t)-1;
+			stateChanges++;
+		}
+
+		// the batches after this one that only differ in their mesh join its multi-draw
+		std::size_t end = i + 1;
+		while (end < batches.size() && JoinsMultiDraw(batch, batches[end]))
+			end++;
+
+		if (batch.geometry == nullptr || submitMode == SUBMIT_LOOP)
+			BindInstances(batch.first);
+
+		switch (batch.pass) {
+		case PASS_BOX:
+			glDrawArraysInstanced(GL_TRIANGLES, 0, (GLsizei)model.GetBoundingBoxVertices().size(), (GLsizei)batch.count);
+			break;
+		case PASS_NORMALS:
+			glDrawArraysInstanced(GL_LINES, 0, (GLsizei)model.GetVertexNormals().size(), (GLsizei)batch.count);
+			break;
+		case PASS_OCCLUSION:
+			// the batches of one run are next to each other, their boxes all count for its query
+			if (i == 0 || batches[i - 1].query != batch.query || batches[i - 1].pass != PASS_OCCLUSION)
+				glBeginQuery(occlusionTarget, batch.query);
+			glDrawArraysInstanced(GL_TRIANGLES, 0, (GLsizei)model.GetBoundingBoxVertices().size(), (GLsizei)batch.count);
+			if (i + 1 == batches.size() || batches[i + 1].query != batch.query)
+				glEndQuery(occlusionTarget);
+			break;
+		default: {
+			const MeshLod& lod = model.GetLod(model.lodLevel);
+			if (batch.pass == PASS_FILL) {
+				for (std::size_t j = i; j < end; j++)
+					triangleCount += (int)(batches[j].model->GetLod(batches[j].model->lodLevel).indexCount / 3 * batches[j].count);
+			}
+
+			if (batch.query != 0) {
+				// the query was issued a frame ago, so waiting on it hardly ever holds the GPU up
+				GLuint available = GL_FALSE;
+				glGetQueryObjectuiv(batch.query, GL_QUERY_RESULT_AVAILABLE, &available);
+				if (available) {
+					GLuint samples = 0;
+					glGetQueryObjectuiv(batch.query, GL_QUERY_RESULT, &samples);
+					occludedDraws += samples == 0;
+				}
+				glBeginConditionalRender(batch.query, GL_QUERY_WAIT);
+				conditionalDraws++;
+			}
+
+			const GLvoid* offset = (const GLvoid*)((batch.geometry->firstIndex + lod.firstIndex) * model.GetIndexSize());
+			if (submitMode == SUBMIT_LOOP) {
+				glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)lod.indexCount, batch.geometry->indexType, offset, (GLsizei)batch.count);
+			}
+			else if (submitMode == SUBMIT_MULTI_DRAW) {
+				// the base instances of the commands find each batch's instances
+				if (sharedFirst != 0) {
+					BindInstances(0);
+					sharedFirst = 0;
+				}
+				glMultiDrawElementsIndirect(GL_TRIANGLES, batch.geometry->indexType, (const GLvoid*)(commandsOffset + command * sizeof(DrawCommand)), (GLsizei)(end - i), 0);
+				command += end - i;
+			}
+			else {
+				if (sharedFirst != batch.first) {
+					BindInstances(batch.first);
+					sharedFirst = batch.first;
+				}
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)lod.indexCount, batch.geometry->indexType, offset, (GLsizei)batch.count, batch.geometry->baseVertex);
+			}
+
+			if (batch.query != 0)
+				glEndConditionalRender();
+			break;
+		}
+		}
+		drawCalls++;
+		i = end;
+	}
+
+	if (occlusionPass) {
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthMask(GL_TRUE);
+		glDepthFunc(GL_LESS);
+	}
+
+	// Unset the textures and the VAO once, after the last draw
+	glBindVertexArray(0);
+	if (texture != nullptr)
+		texture->unbind(0);
+}
+
 void Renderer::Render(const Scene& scene)
 {
+	// also when nothing is drawn, the writes of the menus go somewhere
+	streamBuffer.NextFrame();
 	if (!scene.GetCameraCount()) {
 		return;
 	}
 
-	std::vector<std::shared_ptr<MeshModel>> models = scene.GetModels();
-	std::vector<Camera*> cameras = scene.GetCameras();
-	std::vector<Light*> lights = scene.GetLights();
+	const std::vector<std::shared_ptr<MeshModel>>& models = scene.GetModels();
+	const std::vector<Camera*>& cameras = scene.GetCameras();
+	const std::vector<Light*>& lights = scene.GetLights();
 
-	Camera activeCamera = scene.GetActiveCamera();
-	glm::mat4 viewMat = activeCamera.GetViewTransformation();
-	glm::mat4 objMat = activeCamera.GetWorldTransformation();
-	glm::mat4 projMat = activeCamera.GetProjTransformation();
-	glm::vec4 lightColors[5] = { glm::vec4(0) };
-	glm::vec4 lightLocations[5] = { glm::vec4(0) };
+	const CameraState& activeCamera = scene.GetActiveCameraState();
+	glm::mat4 view = activeCamera.view * activeCamera.world;
 
+	// camera and light params
+	FrameData frame;
+	frame.view = view;
+	frame.projection = activeCamera.projection;
 	for (int i = 0; i < 5; i++) {
+		frame.lightColors[i] = glm::vec4(0);
+		frame.lightLocations[i] = glm::vec4(0);
 		if (i < lights.size()) {
 			Light* light = lights.at(i);
 			glm::vec3 pos = light->location;
-			lightColors[i] = light->color;
-			lightLocations[i] = glm::vec4(pos.x, pos.y, -pos.z, 1);
+			frame.lightColors[i] = light->color;
+			frame.lightLocations[i] = glm::vec4(pos.x, pos.y, -pos.z, 1);
 		}
 	}
-	
+
 	colorShader.use();
+	frameData = frame;
+
+	renderQueue.Clear();
+	instances.clear();
+	batches.clear();
+	closeModels.clear();
+	objectCount = 0;
+	drawCalls = 0;
+	stateChanges = 2; // the program and the FrameData block
+	conditionalDraws = 0;
+	occludedDraws = 0;
+	triangleCount = 0;
+	frameIndex++;
+
+	candidates.clear();
+	candidateBoxes.clear();
+
+	// collect models
+	for (const std::shared_ptr<MeshModel>& model : models) {
+		CollectModel(scene, model.get());
+	}
 
-	// camera params
-	colorShader.setUniform("view", viewMat * objMat);
-	colorShader.setUniform("projection", projMat);
-	colorShader.setUniform("lightColors", lightColors);
-	colorShader.setUniform("lightLocations", lightLocations);
-	
-	// draw models
-	for (std::shared_ptr<MeshModel> model : models) {
-		model->SetWorldTransformation();
-		DrawModel(scene, &(*model));
-	}
-	
-	// draw cameras
+	// collect cameras
 	for (int i = 0; i < scene.GetCameraCount(); i++) {
 		if (scene.GetActiveCameraIndex() == i)
 			continue;
 		MeshModel* model = cameras.at(i);
 		model->scale = glm::vec3(0.1);
-		model->SetWorldTransformation();
-		DrawModel(scene, model);
+		CollectModel(scene, model);
 	}
 
-	// draw lights
+	// collect lights
 	for (int i = 0; i < scene.GetLightCount(); i++) {
 		MeshModel* model = lights.at(i);
 		model->scale = glm::vec3(0.1);
-		model->SetWorldTransformation();
-		DrawModel(scene, &(*model));
+		CollectModel(scene, model);
+	}
+
+	// queue what the active camera can see
+	UpdateSceneBVH();
+	visibleCandidates.clear();
+	if (frustumCulling) {
+		frustum.Set(activeCamera.projection * view);
+		sceneBVH.QueryFrustum(frustum, visibleCandidates);
+	}
+	else {
+		for (std::size_t i = 0; i < candidates.size(); i++)
+			visibleCandidates.push_back((std::uint32_t)i);
+	}
+	visibleCount = (int)visibleCandidates.size();
+	culledCount = (int)candidates.size() - visibleCount;
+
+	// a box the near plane cuts could pass no samples while the model is right in front of the camera:
+	// those are too close to need a query anyway. The margin is the eye's distance to the near plane's corners
+	glm::mat4 inverseView = glm::inverse(view);
+	glm::vec3 eye(inverseView[3]);
+	glm::vec4 nearCorner = glm::inverse(activeCamera.projection * view) * glm::vec4(1.0f, 1.0f, -1.0f, 1.0f);
+	glm::vec3 nearMargin(glm::length(glm::vec3(nearCorner) / nearCorner.w - eye));
+
+	for (std::uint32_t i : visibleCandidates) {
+		const AABB& box = candidateBoxes[i];
+		MeshModel* model = candidates[i].model;
+		model->lodLevel = levelOfDetail ? SelectLod(*model, box, view, activeCamera.projection) : 0;
+		QueueModel(view, model, candidates[i].transform);
+
+		if (occlusionCulling && AABB(box.mins - nearMargin, box.maxs + nearMargin).Contains(eye))
+			closeModels.insert(model);
 	}
+
+	if (submitMode == SUBMIT_MULTI_DRAW && !multiDrawSupported)
+		submitMode = SUBMIT_BASE_VERTEX;
+
+	renderQueue.Sort();
+	BuildBatches();
+
+	// only the CPU side: the GL calls return long before the GPU runs them
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	SubmitBatches();
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	submitMs[submitMode] = submitMs[submitMode] == 0.0 ? ms : 0.95 * submitMs[submitMode] + 0.05 * ms;
+}
+
+int Renderer::GetDrawCallCount() const
+{
+	return drawCalls;
+}
+
+int Renderer::GetStateChangeCount() const
+{
+	return stateChanges;
+}
+
+int Renderer::GetVisibleCount() const
+{
+	return visibleCount;
+}
+
+int Renderer::GetCulledCount() const
+{
+	return culledCount;
+}
+
+int Renderer::GetConditionalDrawCount() const
+{
+	return conditionalDraws;
+}
+
+int Renderer::GetOccludedDrawCount() const
+{
+	return occludedDraws;
+}
+
+int Renderer::GetTriangleCount() const
+{
+	return triangleCount;
+}
+
+bool Renderer::IsSubmitModeSupported(SubmitMode mode) const
+{
+	return mode != SUBMIT_MULTI_DRAW || multiDrawSupported;
+}
+
+double Renderer::GetSubmitMs(SubmitMode mode) const
+{
+	return submitMs[mode];
+}
+
+const GeometryBuffer& Renderer::GetSharedGeometry() const
+{
+	return sharedGeometry;
+}
+
+const StreamBuffer& Renderer::GetStreamBuffer() const
+{
+	return streamBuffer;
+}
+
+const SceneBVH& Renderer::GetSceneBVH() const
+{
+	return sceneBVH;
+}
+
+MeshModel* Renderer::GetSceneObject(std::uint32_t object) const
+{
+	return candidates[object].model;
+}
+
+int Renderer::GetBVHRebuildCount() const
+{
+	return bvhRebuilds;
+}
+
+MeshModel* Renderer::Pick(const Ray& ray, float& distance) const
+{
+	// RayCaster rays reach the far plane at t = 1
+	std::uint32_t object = sceneBVH.Raycast(ray.origin, ray.direction, 1.0f, distance,
+		[this, &ray](std::uint32_t object, float& distance) {
+			Ray local = RayCaster::ToLocal(ray, candidates[object].transform);
+			float hit;
+			if (candidates[object].model->GetTriangleBVH().Raycast(local.origin, local.direction, distance, hit) == MeshBVH::NoTriangle)
+				return false;
+			distance = hit;
+			return true;
+		});
+	return object != SceneBVH::NoObject ? candidates[object].model : nullptr;
 }
 
 void Renderer::LoadShaders()
 {
 	colorShader.loadShaders("vshader.glsl", "fshader.glsl");
+	colorShader.bindUniformBlock("FrameData", FrameDataBinding);
+	colorShader.bindUniformBlock("ObjectData", ObjectDataBinding);
+
+	// textures are always bound at slot #0
+	colorShader.use();
+	colorShader.setUniformSampler(UNIFORM_TEXTURE_MAP, 0);
+
+	// like the shaders, GL objects need the context, which exists by now
+	sharedGeometry.Create();
+
+	// any samples passed stops counting at the first one, but is GL 3.3: samples passed does the same job
+	occlusionTarget = GLAD_GL_VERSION_3_3 ? GL_ANY_SAMPLES_PASSED : GL_SAMPLES_PASSED;
+	streamBuffer.Create(1024 * 1024);
+
+	// base instances in indirect commands are GL 4.2, multi-draws of them 4.3
+	multiDrawSupported = GLAD_GL_VERSION_4_3 != 0;
 }
\ No newline at end of file
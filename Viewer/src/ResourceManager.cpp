@@ -0,0 +1,211 @@
+#include "ResourceManager.h"
+#include "Utils.h"
+#include <cstring>
+#include <filesystem>
+
+template <typename Resource>
+std::shared_ptr<Resource> ResourceManager::Table<Resource>::Find(std::uint64_t hash) const
+{
+	auto entry = byHash.find(hash);
+	if (entry == byHash.end())
+	{
+		return nullptr;
+	}
+	return entry->second.resource.lock();
+}
+
+template <typename Resource>
+std::shared_ptr<Resource> ResourceManager::Table<Resource>::Find(const std::string& fileKey) const
+{
+	if (fileKey.empty())
+	{
+		return nullptr;
+	}
+
+	auto file = byFile.find(fileKey);
+	if (file == byFile.end())
+	{
+		return nullptr;
+	}
+	return Find(file->second);
+}
+
+template <typename Resource>
+std::shared_ptr<Resource> ResourceManager::Table<Resource>::Add(const std::string& fileKey, std::uint64_t hash, const std::string& name, const std::shared_ptr<Resource>& resource)
+{
+	if (!fileKey.empty())
+	{
+		byFile[fileKey] = hash;
+	}
+
+	std::shared_ptr<Resource> resident = Find(hash);
+	if (resident)
+	{
+		return resident;
+	}
+
+	Entry& entry = byHash[hash];
+	entry.name = name;
+	entry.resource = resource;
+	return resource;
+}
+
+template <typename Resource>
+void ResourceManager::Table<Resource>::Prune()
+{
+	for (auto entry = byHash.begin(); entry != byHash.end();)
+	{
+		if (entry->second.resource.expired())
+		{
+			entry = byHash.erase(entry);
+		}
+		else
+		{
+			++entry;
+		}
+	}
+
+	for (auto file = byFile.begin(); file != byFile.end();)
+	{
+		if (byHash.count(file->second) == 0)
+		{
+			file = byFile.erase(file);
+		}
+		else
+		{
+			++file;
+		}
+	}
+}
+
+std::string ResourceManager::GetFileKey(const std::string& filePath)
+{
+	std::error_code error;
+	std::filesystem::path path = std::filesystem::weakly_canonical(filePath, error);
+	if (error)
+	{
+		path = filePath;
+	}
+
+	std::uintmax_t size = std::filesystem::file_size(path, error);
+	if (error)
+	{
+		return {};
+	}
+
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+	if (error)
+	{
+		return {};
+	}
+
+	return path.string() + '|' + std::to_string(size) + '|' + std::to_string(writeTime.time_since_epoch().count());
+}
+
+std::uint64_t ResourceManager::HashContent(const void* data, std::size_t size, std::uint64_t hash)
+{
+	// FNV-1a, a word at a time; the shift carries the high bits of each product back down
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	std::size_t i = 0;
+	for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t))
+	{
+		std::uint64_t word;
+		std::memcpy(&word, bytes + i, sizeof(word));
+		hash = (hash ^ word) * 1099511628211ull;
+		hash ^= hash >> 32;
+	}
+	for (; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+std::uint64_t ResourceManager::HashMeshData(const MeshData& data)
+{
+	std::uint64_t counts[2] = { data.modelVertices.size(), data.modelIndices.size() };
+	std::uint64_t hash = HashContent(counts, sizeof(counts));
+	hash = HashContent(data.modelVertices.data(), data.modelVertices.size() * sizeof(Vertex), hash);
+	return HashContent(data.modelIndices.data(), data.modelIndices.size() * sizeof(std::uint32_t), hash);
+}
+
+std::shared_ptr<MeshResource> ResourceManager::LoadMesh(const std::string& filePath)
+{
+	std::string fileKey = GetFileKey(filePath);
+	std::shared_ptr<MeshResource> mesh = FindMesh(fileKey);
+	if (mesh)
+	{
+		return mesh;
+	}
+
+	MeshData data = Utils::LoadMeshData(filePath);
+	std::uint64_t hash = HashMeshData(data);
+	mesh = FindMesh(hash);
+	if (!mesh)
+	{
+		mesh = std::make_shared<MeshResource>(std::move(data));
+	}
+	return AddMesh(fileKey, hash, Utils::GetFileName(filePath), mesh);
+}
+
+std::shared_ptr<MeshResource> ResourceManager::FindMesh(const std::string& fileKey) const
+{
+	return meshes.Find(fileKey);
+}
+
+std::shared_ptr<MeshResource> ResourceManager::FindMesh(std::uint64_t hash) const
+{
+	return meshes.Find(hash);
+}
+
+std::shared_ptr<Texture2D> ResourceManager::FindTexture(const std::string& fileKey) const
+{
+	return textures.Find(fileKey);
+}
+
+std::shared_ptr<Texture2D> ResourceManager::FindTexture(std::uint64_t hash) const
+{
+	return textures.Find(hash);
+}
+
+std::shared_ptr<MeshResource> ResourceManager::AddMesh(const std::string& fileKey, std::uint64_t hash, const std::string& name, const std::shared_ptr<MeshResource>& mesh)
+{
+	return meshes.Add(fileKey, hash, name, mesh);
+}
+
+std::shared_ptr<Texture2D> ResourceManager::AddTexture(const std::string& fileKey, std::uint64_t hash, const std::string& name, const std::shared_ptr<Texture2D>& texture)
+{
+	return textures.Add(fileKey, hash, name, texture);
+}
+
+std::vector<ResourceManager::ResidentResource> ResourceManager::GetResidentMeshes()
+{
+	meshes.Prune();
+
+	std::vector<ResidentResource> resident;
+	for (auto& entry : meshes.byHash)
+	{
+		std::shared_ptr<MeshResource> mesh = entry.second.resource.lock();
+		if (mesh)
+		{
+			resident.push_back({ entry.second.name, mesh->GetVideoMemorySize(), mesh.use_count() - 1 });
+		}
+	}
+	return resident;
+}
+
+std::vector<ResourceManager::ResidentResource> ResourceManager::GetResidentTextures()
+{
+	textures.Prune();
+
+	std::vector<ResidentResource> resident;
+	for (auto& entry : textures.byHash)
+	{
+		std::shared_ptr<Texture2D> texture = entry.second.resource.lock();
+		if (texture)
+		{
+			resident.push_back({ entry.second.name, texture->getMemorySize(), texture.use_count() - 1 });
+		}
+	}
+	return resident;
+}
@@ -98,16 +98,16 @@ const int Scene::GetActiveModelIndex() const
 	return activeModelIndex;
 }
 
-std::vector<std::shared_ptr<MeshModel>> Scene::GetModels() const {
+const std::vector<std::shared_ptr<MeshModel>>& Scene::GetModels() const {
 	return models;
 }
 
-std::vector<Camera*> Scene::GetCameras() const
+const std::vector<Camera*>& Scene::GetCameras() const
 {
 	return cameras;
 }
 
-std::vector<Light*> Scene::GetLights() const
+const std::vector<Light*>& Scene::GetLights() const
 {
 	return lights;
 }
@@ -138,6 +138,11 @@ Camera & Scene::GetActiveCamera() const
 	return *cameras.at(i);
 }
 
+const CameraState& Scene::GetActiveCameraState() const
+{
+	return cameras[activeCameraIndex]->GetState();
+}
+
 void Scene::SetWorldTransformation()
 {
 	this->worldTransformation = Utils::GetTransformationMatrix(scale, rotation, translation);
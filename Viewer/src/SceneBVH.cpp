@@ -0,0 +1,422 @@
+#include "SceneBVH.h"
+#include <algorithm>
+
+SceneBVH::SceneBVH() :
+	builtCost(0.0f),
+	depth(0)
+{
+}
+
+void SceneBVH::Clear()
+{
+	nodes.clear();
+	objectIndices.clear();
+	objectBoxes.clear();
+	objectLeaves.clear();
+	dirtyLeaves.clear();
+	leafDirty.clear();
+	builtCost = 0.0f;
+	depth = 0;
+}
+
+AABB SceneBVH::GetObjectsBox(std::uint32_t first, std::uint32_t count) const
+{
+	AABB box;
+	for (std::uint32_t i = first; i < first + count; i++)
+	{
+		box.Grow(objectBoxes[objectIndices[i]]);
+	}
+	return box;
+}
+
+void SceneBVH::Build(const std::vector<AABB>& boxes)
+{
+	Clear();
+	if (boxes.empty())
+	{
+		return;
+	}
+
+	objectBoxes = boxes;
+	objectLeaves.assign(boxes.size(), 0);
+	nodes.reserve(2 * boxes.size());
+
+	std::vector<BuildItem> items(boxes.size());
+	AABB rootBox;
+	for (std::uint32_t object = 0; object < boxes.size(); object++)
+	{
+		items[object].box = boxes[object];
+		items[object].center = boxes[object].GetCenter();
+		items[object].object = object;
+		rootBox.Grow(boxes[object]);
+	}
+
+	Node root;
+	root.box = rootBox;
+	root.left = 0;
+	root.parent = 0;
+	root.first = 0;
+	root.count = (std::uint32_t)boxes.size();
+	nodes.push_back(root);
+
+	// depth first with an explicit stack, so even a badly unbalanced tree can't overflow the call stack
+	std::vector<std::pair<std::uint32_t, int>> stack;
+	stack.push_back(std::make_pair(0u, 1));
+	while (!stack.empty())
+	{
+		std::uint32_t nodeIndex = stack.back().first;
+		int level = stack.back().second;
+		stack.pop_back();
+		depth = std::max(depth, level);
+
+		Split(nodeIndex, items);
+		if (nodes[nodeIndex].left != 0)
+		{
+			stack.push_back(std::make_pair(nodes[nodeIndex].left + 1, level + 1));
+			stack.push_back(std::make_pair(nodes[nodeIndex].left, level + 1));
+		}
+	}
+
+	objectIndices.resize(items.size());
+	for (std::size_t i = 0; i < items.size(); i++)
+	{
+		objectIndices[i] = items[i].object;
+	}
+
+	for (std::uint32_t n = 0; n < nodes.size(); n++)
+	{
+		if (nodes[n].left != 0)
+			continue;
+		for (std::uint32_t i = nodes[n].first; i < nodes[n].first + nodes[n].count; i++)
+		{
+			objectLeaves[objectIndices[i]] = n;
+		}
+	}
+	leafDirty.assign(nodes.size(), 0);
+	builtCost = GetCost();
+}
+
+void SceneBVH::Split(std::uint32_t nodeIndex, std::vector<BuildItem>& items)
+{
+	const std::uint32_t first = nodes[nodeIndex].first;
+	const std::uint32_t count = nodes[nodeIndex].count;
+	if (count <= 1)
+	{
+		return;
+	}
+
+	BuildItem* begin = items.data() + first;
+	BuildItem* end = begin + count;
+
+	AABB centers;
+	for (const BuildItem* item = begin; item != end; item++)
+	{
+		centers.Grow(item->center);
+	}
+
+	// SAH: a split costs one box test plus, for each side, its objects weighted by the chance a query
+	// reaching this node also reaches that side, which is their ratio of surface areas
+	float parentArea = std::max(nodes[nodeIndex].box.GetSurfaceArea(), 1e-12f);
+	float bestCost = (float)count;
+	int bestAxis = -1;
+	int bestBin = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float low = centers.mins[axis];
+		float high = centers.maxs[axis];
+		if (high <= low)
+			continue;
+
+		AABB binBoxes[BinCount];
+		std::uint32_t binCounts[BinCount] = { 0 };
+		float scale = BinCount / (high - low);
+		for (const BuildItem* item = begin; item != end; item++)
+		{
+			int bin = std::min((int)((item->center[axis] - low) * scale), BinCount - 1);
+			binBoxes[bin].Grow(item->box);
+			binCounts[bin]++;
+		}
+
+		// right to left sweep first, then the left to right one evaluates each split
+		float rightAreas[BinCount];
+		std::uint32_t rightCounts[BinCount];
+		AABB right;
+		std::uint32_t rightCount = 0;
+		for (int bin = BinCount - 1; bin > 0; bin--)
+		{
+			right.Grow(binBoxes[bin]);
+			rightCount += binCounts[bin];
+			rightAreas[bin] = right.GetSurfaceArea();
+			rightCounts[bin] = rightCount;
+		}
+
+		AABB left;
+		std::uint32_t leftCount = 0;
+		for (int bin = 0; bin < BinCount - 1; bin++)
+		{
+			left.Grow(binBoxes[bin]);
+			leftCount += binCounts[bin];
+			if (leftCount == 0 || rightCounts[bin + 1] == 0)
+				continue;
+
+			float cost = 1.0f + (left.GetSurfaceArea() * leftCount + rightAreas[bin + 1] * rightCounts[bin + 1]) / parentArea;
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = bin;
+			}
+		}
+	}
+
+	BuildItem* middle;
+	if (bestAxis >= 0)
+	{
+		float low = centers.mins[bestAxis];
+		float scale = BinCount / (centers.maxs[bestAxis] - low);
+		middle = std::partition(begin, end, [&](const BuildItem& item) {
+			int bin = std::min((int)((item.center[bestAxis] - low) * scale), BinCount - 1);
+			return bin <= bestBin;
+		});
+	}
+	else if (count > MaxLeafSize)
+	{
+		// no split pays off, or all centers coincide, but the leaf would be too big: halve it
+		middle = begin + count / 2;
+	}
+	else {
+		return;
+	}
+
+	std::uint32_t leftCount = (std::uint32_t)(middle - begin);
+	std::uint32_t left = (std::uint32_t)nodes.size();
+	for (int side = 0; side < 2; side++)
+	{
+		Node child;
+		child.left = 0;
+		child.parent = nodeIndex;
+		child.first = side == 0 ? first : first + leftCount;
+		child.count = side == 0 ? leftCount : count - leftCount;
+		for (std::uint32_t i = child.first; i < child.first + child.count; i++)
+		{
+			child.box.Grow(items[i].box);
+		}
+		nodes.push_back(child);
+	}
+	nodes[nodeIndex].left = left;
+}
+
+void SceneBVH::SetBox(std::uint32_t object, const AABB& box)
+{
+	if (objectBoxes[object] == box)
+		return;
+
+	objectBoxes[object] = box;
+	std::uint32_t leaf = objectLeaves[object];
+	if (!leafDirty[leaf])
+	{
+		leafDirty[leaf] = 1;
+		dirtyLeaves.push_back(leaf);
+	}
+}
+
+const AABB& SceneBVH::GetBox(std::uint32_t object) const
+{
+	return objectBoxes[object];
+}
+
+std::size_t SceneBVH::Refit()
+{
+	std::size_t changed = 0;
+	for (std::uint32_t leaf : dirtyLeaves)
+	{
+		leafDirty[leaf] = 0;
+		AABB box = GetObjectsBox(nodes[leaf].first, nodes[leaf].count);
+		if (box == nodes[leaf].box)
+			continue;
+		nodes[leaf].box = box;
+		changed++;
+
+		// up to the root, unless a parent turns out not to change: then neither do the ones above it
+		std::uint32_t index = leaf;
+		while (index != 0)
+		{
+			std::uint32_t parent = nodes[index].parent;
+			AABB parentBox = nodes[nodes[parent].left].box;
+			parentBox.Grow(nodes[nodes[parent].left + 1].box);
+			if (parentBox == nodes[parent].box)
+				break;
+			nodes[parent].box = parentBox;
+			changed++;
+			index = parent;
+		}
+	}
+	dirtyLeaves.clear();
+	return changed;
+}
+
+bool SceneBVH::NeedsRebuild() const
+{
+	return GetCost() > 2.0f * builtCost;
+}
+
+void SceneBVH::QueryFrustum(const Frustum& frustum, std::vector<std::uint32_t>& objects) const
+{
+	if (nodes.empty())
+		return;
+
+	std::vector<std::uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		FrustumTest test = frustum.Classify(node.box);
+		if (test == FRUSTUM_OUTSIDE)
+			continue;
+
+		if (test == FRUSTUM_INSIDE)
+		{
+			objects.insert(objects.end(), objectIndices.begin() + node.first, objectIndices.begin() + node.first + node.count);
+		}
+		else if (node.left == 0)
+		{
+			for (std::uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				const AABB& box = objectBoxes[objectIndices[i]];
+				if (frustum.IsVisible(box.GetCenter(), box.GetExtent()))
+					objects.push_back(objectIndices[i]);
+			}
+		}
+		else {
+			stack.push_back(node.left + 1);
+			stack.push_back(node.left);
+		}
+	}
+}
+
+void SceneBVH::QueryBox(const AABB& box, std::vector<std::uint32_t>& objects) const
+{
+	if (nodes.empty())
+		return;
+
+	std::vector<std::uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (!node.box.Overlaps(box))
+			continue;
+
+		if (node.left == 0)
+		{
+			for (std::uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				if (objectBoxes[objectIndices[i]].Overlaps(box))
+					objects.push_back(objectIndices[i]);
+			}
+		}
+		else {
+			stack.push_back(node.left + 1);
+			stack.push_back(node.left);
+		}
+	}
+}
+
+std::uint32_t SceneBVH::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance,
+	const std::function<bool(std::uint32_t, float&)>& hitTest) const
+{
+	std::uint32_t nearest = NoObject;
+	distance = maxDistance;
+	if (nodes.empty())
+		return nearest;
+
+	glm::vec3 inverseDirection = glm::vec3(1.0f) / direction;
+	std::vector<std::uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		float entry;
+		if (!node.box.IntersectRay(origin, inverseDirection, distance, entry))
+			continue;
+
+		if (node.left == 0)
+		{
+			for (std::uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				if (!objectBoxes[objectIndices[i]].IntersectRay(origin, inverseDirection, distance, entry))
+					continue;
+				if (hitTest && !hitTest(objectIndices[i], distance))
+					continue;
+				nearest = objectIndices[i];
+				if (!hitTest)
+					distance = entry;
+			}
+			continue;
+		}
+
+		// the nearer child goes on top, so hits there cut the far one short
+		float leftEntry, rightEntry;
+		bool leftHit = nodes[node.left].box.IntersectRay(origin, inverseDirection, distance, leftEntry);
+		bool rightHit = nodes[node.left + 1].box.IntersectRay(origin, inverseDirection, distance, rightEntry);
+		if (leftHit && rightHit)
+		{
+			stack.push_back(leftEntry < rightEntry ? node.left + 1 : node.left);
+			stack.push_back(leftEntry < rightEntry ? node.left : node.left + 1);
+		}
+		else if (leftHit)
+		{
+			stack.push_back(node.left);
+		}
+		else if (rightHit)
+		{
+			stack.push_back(node.left + 1);
+		}
+	}
+	return nearest;
+}
+
+float SceneBVH::GetCost() const
+{
+	if (nodes.empty())
+		return 0.0f;
+
+	float rootArea = std::max(nodes[0].box.GetSurfaceArea(), 1e-12f);
+	float cost = 0.0f;
+	for (const Node& node : nodes)
+	{
+		float area = node.box.GetSurfaceArea() / rootArea;
+		cost += node.left == 0 ? area * node.count : area;
+	}
+	return cost;
+}
+
+std::size_t SceneBVH::GetObjectCount() const
+{
+	return objectBoxes.size();
+}
+
+std::size_t SceneBVH::GetNodeCount() const
+{
+	return nodes.size();
+}
+
+int SceneBVH::GetDepth() const
+{
+	return depth;
+}
+
+const std::vector<SceneBVH::Node>& SceneBVH::GetNodes() const
+{
+	return nodes;
+}
@@ -8,8 +8,8 @@
 //-----------------------------------------------------------------------------
 // Constructor
 //-----------------------------------------------------------------------------
-ShaderProgram::ShaderProgram()
-	: programHandle(0)
+ShaderProgram::ShaderProgram() :
+	uniformHandles(UNIFORM_COUNT, UniformHandle{ -1, GL_NONE, 0 })
 {}
 
 
@@ -18,8 +18,7 @@ ShaderProgram::ShaderProgram()
 //-----------------------------------------------------------------------------
 ShaderProgram::~ShaderProgram()
 {
-	// Delete the program
-	glDeleteProgram(programHandle);
+	// programHandle deletes the program
 }
 
 //-----------------------------------------------------------------------------
@@ -44,24 +43,24 @@ bool ShaderProgram::loadShaders(const char* vsFilename, const char* fsFilename)
 	glCompileShader(fs);
 	checkCompileErrors(fs, FRAGMENT);
 
-	programHandle = glCreateProgram();
-	if (programHandle == 0)
+	programHandle.Create();
+	if (programHandle.Get() == 0)
 	{
 		std::cerr << "Unable to create shader program!" << std::endl;
 		return false;
 	}
 
-	glAttachShader(programHandle, vs);
-	glAttachShader(programHandle, fs);
+	glAttachShader(programHandle.Get(), vs);
+	glAttachShader(programHandle.Get(), fs);
 
-	glLinkProgram(programHandle);
-	checkCompileErrors(programHandle, PROGRAM);
+	glLinkProgram(programHandle.Get());
+	checkCompileErrors(programHandle.Get(), PROGRAM);
 
 
 	glDeleteShader(vs);
 	glDeleteShader(fs);
 
-	uniformLocations.clear();
+	reflectUniforms();
 
 	return true;
 }
@@ -102,9 +101,9 @@ string ShaderProgram::fileToString(const string& filename) const
 //-----------------------------------------------------------------------------
 void ShaderProgram::use() const
 {
-	if (programHandle > 0)
+	if (programHandle.Get() > 0)
 	{
-		glUseProgram(programHandle);
+		glUseProgram(programHandle.Get());
 	}
 }
 
@@ -151,7 +150,106 @@ void  ShaderProgram::checkCompileErrors(GLuint shader, ShaderType type) const
 //-----------------------------------------------------------------------------
 GLuint ShaderProgram::getProgram() const
 {
-	return programHandle;
+	return programHandle.Get();
+}
+
+//-----------------------------------------------------------------------------
+// Looks up every active uniform of the default block once, after linking.
+// Uniform block members are skipped: they have no location and are set
+// through buffers, see UniformBlocks.h.
+//-----------------------------------------------------------------------------
+void ShaderProgram::reflectUniforms()
+{
+	GLuint program = programHandle.Get();
+	uniformsByName.clear();
+	uniformHandles.assign(UNIFORM_COUNT, UniformHandle{ -1, GL_NONE, 0 });
+
+	GLint count = 0;
+	GLint maxLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	std::vector<GLchar> buffer(maxLength + 1);
+	for (GLint i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		UniformHandle handle;
+		glGetActiveUniform(program, (GLuint)i, (GLsizei)buffer.size(), &length, &handle.size, &handle.type, buffer.data());
+		string name(buffer.data(), length);
+
+		handle.location = glGetUniformLocation(program, name.c_str());
+		if (handle.location < 0)
+			continue;
+
+		// Arrays are reported as "name[0]", they are set by their plain name
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+			name.resize(name.size() - 3);
+		uniformsByName[name] = handle;
+	}
+
+	for (int id = 0; id < UNIFORM_COUNT; id++)
+	{
+		std::map<string, UniformHandle>::const_iterator it = uniformsByName.find(UniformNames[id]);
+		if (it != uniformsByName.end())
+			uniformHandles[id] = it->second;
+	}
+}
+
+static bool IsSamplerType(GLenum type)
+{
+	switch (type)
+	{
+	case GL_SAMPLER_1D:
+	case GL_SAMPLER_2D:
+	case GL_SAMPLER_3D:
+	case GL_SAMPLER_CUBE:
+	case GL_SAMPLER_2D_SHADOW:
+		return true;
+	default:
+		return false;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// In debug builds, reports a value set with a type the GLSL doesn't declare
+// and refuses to set it. An int may set a bool or a sampler, like glUniform1i.
+//-----------------------------------------------------------------------------
+bool ShaderProgram::checkType(const UniformHandle& handle, GLenum type, const GLchar* name)
+{
+#ifndef NDEBUG
+	bool matches = handle.type == type;
+	if (type == GL_INT)
+		matches = matches || handle.type == GL_BOOL || IsSamplerType(handle.type);
+	else if (IsSamplerType(type))
+		matches = IsSamplerType(handle.type);
+
+	if (!matches)
+	{
+		std::cerr << "Error! Uniform " << name << " is set with a value of the wrong type" << std::endl;
+		return false;
+	}
+#endif
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Returns the handle of an active uniform taking values of the given type.
+// NULL if the program doesn't use it, setting it is then a no-op as in GL.
+//-----------------------------------------------------------------------------
+const ShaderProgram::UniformHandle* ShaderProgram::getHandle(const GLchar* name, GLenum type) const
+{
+	std::map<string, UniformHandle>::const_iterator it = uniformsByName.find(name);
+	if (it == uniformsByName.end() || !checkType(it->second, type, name))
+		return NULL;
+	return &it->second;
+}
+
+const ShaderProgram::UniformHandle* ShaderProgram::getHandle(UniformId id, GLenum type) const
+{
+	const UniformHandle& handle = uniformHandles[id];
+	if (handle.location < 0 || !checkType(handle, type, UniformNames[id]))
+		return NULL;
+	return &handle;
 }
 
 //-----------------------------------------------------------------------------
@@ -159,8 +257,14 @@ GLuint ShaderProgram::getProgram() const
 //-----------------------------------------------------------------------------
 void ShaderProgram::setUniform(const GLchar* name, const glm::vec2& v)
 {
-	GLint loc = getUniformLocation(name);
-	glUniform2f(loc, v.x, v.y);
+	if (const UniformHandle* handle = getHandle(name, GL_FLOAT_VEC2))
+		glUniform2f(handle->location, v.x, v.y);
+}
+
+void ShaderProgram::setUniform(UniformId id, const glm::vec2& v)
+{
+	if (const UniformHandle* handle = getHandle(id, GL_FLOAT_VEC2))
+		glUniform2f(handle->location, v.x, v.y);
 }
 
 //-----------------------------------------------------------------------------
@@ -168,8 +272,14 @@ void ShaderProgram::setUniform(const GLchar* name, const glm::vec2& v)
 //-----------------------------------------------------------------------------
 void ShaderProgram::setUniform(const GLchar* name, const glm::vec3& v)
 {
-	GLint loc = getUniformLocation(name);
-	glUniform3f(loc, v.x, v.y, v.z);
+	if (const UniformHandle* handle = getHandle(name, GL_FLOAT_VEC3))
+		glUniform3f(handle->location, v.x, v.y, v.z);
+}
+
+void ShaderProgram::setUniform(UniformId id, const glm::vec3& v)
+{
+	if (const UniformHandle* handle = getHandle(id, GL_FLOAT_VEC3))
+		glUniform3f(handle->location, v.x, v.y, v.z);
 }
 
 //-----------------------------------------------------------------------------
@@ -177,20 +287,41 @@ void ShaderProgram::setUniform(const GLchar* name, const glm::vec3& v)
 //-----------------------------------------------------------------------------
 void ShaderProgram::setUniform(const GLchar* name, const glm::vec4& v)
 {
-	GLint loc = getUniformLocation(name);
-	glUniform4f(loc, v.x, v.y, v.z, v.w);
+	if (const UniformHandle* handle = getHandle(name, GL_FLOAT_VEC4))
+		glUniform4f(handle->location, v.x, v.y, v.z, v.w);
+}
+
+void ShaderProgram::setUniform(UniformId id, const glm::vec4& v)
+{
+	if (const UniformHandle* handle = getHandle(id, GL_FLOAT_VEC4))
+		glUniform4f(handle->location, v.x, v.y, v.z, v.w);
 }
 
+//-----------------------------------------------------------------------------
+// Sets a whole glm::vec4 / glm::vec3 array uniform, v holds one per element
+//-----------------------------------------------------------------------------
 void ShaderProgram::setUniform(const GLchar * name, const glm::vec4 * v)
 {
-	GLint loc = getUniformLocation(name);
-	glUniform4fv(loc, 5, glm::value_ptr(v[0]));
+	if (const UniformHandle* handle = getHandle(name, GL_FLOAT_VEC4))
+		glUniform4fv(handle->location, handle->size, glm::value_ptr(v[0]));
+}
+
+void ShaderProgram::setUniform(UniformId id, const glm::vec4 * v)
+{
+	if (const UniformHandle* handle = getHandle(id, GL_FLOAT_VEC4))
+		glUniform4fv(handle->location, handle->size, glm::value_ptr(v[0]));
 }
 
 void ShaderProgram::setUniform(const GLchar * name, const glm::vec3 * v)
 {
-	GLint loc = getUniformLocation(name);
-	glUniform3fv(loc, 5, glm::value_ptr(v[0]));
+	if (const UniformHandle* handle = getHandle(name, GL_FLOAT_VEC3))
+		glUniform3fv(handle->location, handle->size, glm::value_ptr(v[0]));
+}
+
+void ShaderProgram::setUniform(UniformId id, const glm::vec3 * v)
+{
+	if (const UniformHandle* handle = getHandle(id, GL_FLOAT_VEC3))
+		glUniform3fv(handle->location, handle->size, glm::value_ptr(v[0]));
 }
 
 //-----------------------------------------------------------------------------
@@ -198,13 +329,17 @@ void ShaderProgram::setUniform(const GLchar * name, const glm::vec3 * v)
 //-----------------------------------------------------------------------------
 void ShaderProgram::setUniform(const GLchar* name, const glm::mat4& m)
 {
-	GLint loc = getUniformLocation(name);
-
-	// loc = location of uniform in shader
 	// count = how many matrices (1 if not an array of mats)
 	// transpose = False for opengl because column major
 	// value = the matrix to set for the uniform
-	glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(m));
+	if (const UniformHandle* handle = getHandle(name, GL_FLOAT_MAT4))
+		glUniformMatrix4fv(handle->location, 1, GL_FALSE, glm::value_ptr(m));
+}
+
+void ShaderProgram::setUniform(UniformId id, const glm::mat4& m)
+{
+	if (const UniformHandle* handle = getHandle(id, GL_FLOAT_MAT4))
+		glUniformMatrix4fv(handle->location, 1, GL_FALSE, glm::value_ptr(m));
 }
 
 //-----------------------------------------------------------------------------
@@ -212,17 +347,29 @@ void ShaderProgram::setUniform(const GLchar* name, const glm::mat4& m)
 //-----------------------------------------------------------------------------
 void ShaderProgram::setUniform(const GLchar* name, const GLfloat f)
 {
-	GLint loc = getUniformLocation(name);
-	glUniform1f(loc, f);
+	if (const UniformHandle* handle = getHandle(name, GL_FLOAT))
+		glUniform1f(handle->location, f);
+}
+
+void ShaderProgram::setUniform(UniformId id, const GLfloat f)
+{
+	if (const UniformHandle* handle = getHandle(id, GL_FLOAT))
+		glUniform1f(handle->location, f);
 }
 
 //-----------------------------------------------------------------------------
-// Sets a GLint shader uniform
+// Sets a GLint shader uniform, also used for bools
 //-----------------------------------------------------------------------------
 void ShaderProgram::setUniform(const GLchar* name, const GLint v)
 {
-	GLint loc = getUniformLocation(name);
-	glUniform1i(loc, v);
+	if (const UniformHandle* handle = getHandle(name, GL_INT))
+		glUniform1i(handle->location, v);
+}
+
+void ShaderProgram::setUniform(UniformId id, const GLint v)
+{
+	if (const UniformHandle* handle = getHandle(id, GL_INT))
+		glUniform1i(handle->location, v);
 }
 
 //-----------------------------------------------------------------------------
@@ -232,25 +379,46 @@ void ShaderProgram::setUniformSampler(const GLchar* name, const GLint& slot)
 {
 	glActiveTexture(GL_TEXTURE0 + slot);
 
-	GLint loc = getUniformLocation(name);
-	glUniform1i(loc, slot);
+	if (const UniformHandle* handle = getHandle(name, GL_SAMPLER_2D))
+		glUniform1i(handle->location, slot);
+}
+
+void ShaderProgram::setUniformSampler(UniformId id, const GLint& slot)
+{
+	glActiveTexture(GL_TEXTURE0 + slot);
+
+	if (const UniformHandle* handle = getHandle(id, GL_SAMPLER_2D))
+		glUniform1i(handle->location, slot);
 }
 
 //-----------------------------------------------------------------------------
-// Returns the uniform identifier given it's string name.
-// NOTE: Shader must be currently active first.
+// Connects a uniform block to a binding point. Returns false if the program
+// has no such block, e.g. because the compiler removed an unused one.
 //-----------------------------------------------------------------------------
-GLint ShaderProgram::getUniformLocation(const GLchar* name)
+bool ShaderProgram::bindUniformBlock(const GLchar* name, GLuint binding)
 {
-	std::map<string, GLint>::iterator it = uniformLocations.find(name);
-
-	// Only need to query the shader program IF it doesn't already exist.
-	if (it == uniformLocations.end())
+	GLuint index = glGetUniformBlockIndex(programHandle.Get(), name);
+	if (index == GL_INVALID_INDEX)
 	{
-		// Find it and add it to the map
-		uniformLocations[name] = glGetUniformLocation(programHandle, name);
+		std::cerr << "Uniform block " << name << " not found in shader program" << std::endl;
+		return false;
 	}
 
-	// Return it
-	return uniformLocations[name];
+	glUniformBlockBinding(programHandle.Get(), index, binding);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Returns the uniform identifier given it's string name, -1 if not active.
+// Locations are all looked up when the program links, see reflectUniforms.
+//-----------------------------------------------------------------------------
+GLint ShaderProgram::getUniformLocation(const GLchar* name) const
+{
+	std::map<string, UniformHandle>::const_iterator it = uniformsByName.find(name);
+	return it != uniformsByName.end() ? it->second.location : -1;
+}
+
+GLint ShaderProgram::getUniformLocation(UniformId id) const
+{
+	return uniformHandles[id].location;
 }
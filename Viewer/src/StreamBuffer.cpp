@@ -0,0 +1,169 @@
+#include "StreamBuffer.h"
+#include <cstring>
+#include <iostream>
+
+// how long one wait for a fence may block before it is retried, in nanoseconds
+static const GLuint64 FenceTimeout = 1000000;
+
+StreamBuffer::StreamBuffer() :
+	mapped(nullptr),
+	persistent(false),
+	regionSize(0),
+	alignment(256),
+	region(0),
+	head(0),
+	waits(0)
+{
+	for (int i = 0; i < RegionCount; i++)
+		fences[i] = nullptr;
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	// the mapping goes away with the buffer
+	DeleteFences();
+}
+
+void StreamBuffer::Create(std::size_t regionSize)
+{
+	GLint offsetAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+	if (offsetAlignment > 0)
+		alignment = (std::size_t)offsetAlignment;
+
+	this->regionSize = Align(regionSize);
+	persistent = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+	CreateStorage();
+}
+
+void StreamBuffer::CreateStorage()
+{
+	const std::size_t capacity = GetCapacity();
+	buffer.Create();
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.Get());
+
+	mapped = nullptr;
+	if (persistent) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, capacity, NULL, flags);
+		mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, capacity, flags);
+		if (mapped == nullptr) {
+			std::cerr << "Unable to map the stream buffer, writing it with glBufferSubData" << std::endl;
+			persistent = false;
+
+			// storage from glBufferStorage can't be respecified, it takes a new buffer
+			buffer.Create();
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.Get());
+		}
+	}
+	if (!persistent)
+		glBufferData(GL_COPY_WRITE_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	region = 0;
+	head = 0;
+}
+
+void StreamBuffer::DeleteFences()
+{
+	for (int i = 0; i < RegionCount; i++) {
+		if (fences[i] != nullptr)
+			glDeleteSync(fences[i]);
+		fences[i] = nullptr;
+	}
+}
+
+void StreamBuffer::NextFrame()
+{
+	retired.clear();
+
+	// everything the region holds is read by commands issued before the fence
+	if (persistent)
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	region = (region + 1) % RegionCount;
+	head = region * regionSize;
+
+	if (persistent && fences[region] != nullptr) {
+		GLenum result = glClientWaitSync(fences[region], 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			// flushing makes sure the fence gets to the GPU at all, otherwise the wait might never end
+			waits++;
+			while (result == GL_TIMEOUT_EXPIRED)
+				result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, FenceTimeout);
+		}
+		if (result == GL_WAIT_FAILED)
+			std::cerr << "Waiting for a stream buffer fence failed" << std::endl;
+		glDeleteSync(fences[region]);
+		fences[region] = nullptr;
+	}
+	else if (!persistent && region == 0) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.Get());
+		glBufferData(GL_COPY_WRITE_BUFFER, GetCapacity(), NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+}
+
+std::size_t StreamBuffer::Align(std::size_t size) const
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+void StreamBuffer::Reserve(std::size_t size)
+{
+	if (head + size <= (region + 1) * regionSize)
+		return;
+
+	// grows in steps of 2 until this frame would have fit, then stays that size
+	std::size_t used = head - region * regionSize;
+	while (regionSize < used + size)
+		regionSize *= 2;
+
+	// the new buffer's regions were never written, so none has to wait
+	retired.push_back(std::move(buffer));
+	DeleteFences();
+	CreateStorage();
+}
+
+std::size_t StreamBuffer::Write(const void* data, std::size_t size)
+{
+	std::size_t alignedSize = Align(size);
+	Reserve(alignedSize);
+
+	std::size_t offset = head;
+	if (persistent) {
+		std::memcpy(mapped + offset, data, size);
+	}
+	else {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.Get());
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+	head += alignedSize;
+	return offset;
+}
+
+void StreamBuffer::Bind(GLuint binding, std::size_t offset, std::size_t size) const
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer.Get(), offset, size);
+}
+
+GLuint StreamBuffer::GetBuffer() const
+{
+	return buffer.Get();
+}
+
+std::size_t StreamBuffer::GetCapacity() const
+{
+	return RegionCount * regionSize;
+}
+
+bool StreamBuffer::IsPersistent() const
+{
+	return persistent;
+}
+
+int StreamBuffer::GetWaitCount() const
+{
+	return waits;
+}
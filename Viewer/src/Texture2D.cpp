@@ -1,6 +1,8 @@
 #include "Texture2D.h"
 #include <iostream>
 #include <cassert>
+#include <cstring>
+#include <vector>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -8,7 +10,7 @@
 // Constructor
 //-----------------------------------------------------------------------------
 Texture2D::Texture2D()
-	: mTexture(0)
+	: mWidth(0), mHeight(0), mMipMaps(false)
 {
 }
 
@@ -17,7 +19,6 @@ Texture2D::Texture2D()
 //-----------------------------------------------------------------------------
 Texture2D::~Texture2D()
 {
-	glDeleteTextures(1, &mTexture);
 }
 
 //-----------------------------------------------------------------------------
@@ -38,28 +39,20 @@ bool Texture2D::loadTexture(const string& fileName, bool generateMipMaps)
 		return false;
 	}
 
-	// Invert image
-	int widthInBytes = width * 4;
-	unsigned char *top = NULL;
-	unsigned char *bottom = NULL;
-	unsigned char temp = 0;
-	int halfHeight = height / 2;
-	for (int row = 0; row < halfHeight; row++)
-	{
-		top = imageData + row * widthInBytes;
-		bottom = imageData + (height - row - 1) * widthInBytes;
-		for (int col = 0; col < widthInBytes; col++)
-		{
-			temp = *top;
-			*top = *bottom;
-			*bottom = temp;
-			top++;
-			bottom++;
-		}
-	}
+	std::vector<unsigned char> flipped(width * height * 4);
+	copyFlipped(imageData, flipped.data(), width, height);
+	stbi_image_free(imageData);
 
-	glGenTextures(1, &mTexture);
-	glBindTexture(GL_TEXTURE_2D, mTexture); // all upcoming GL_TEXTURE_2D operations will affect our texture object (mTexture)
+	return createTexture(width, height, flipped.data(), generateMipMaps);
+}
+
+//-----------------------------------------------------------------------------
+// Create the GL texture object and upload RGBA pixels to it
+//-----------------------------------------------------------------------------
+bool Texture2D::createTexture(int width, int height, const void* pixels, bool generateMipMaps)
+{
+	mTexture.Create(); // replaces (and deletes) the old texture
+	glBindTexture(GL_TEXTURE_2D, mTexture.Get()); // all upcoming GL_TEXTURE_2D operations will affect our texture object (mTexture)
 
 											// Set the texture wrapping/filtering options (on the currently bound texture object)
 											// GL_CLAMP_TO_EDGE
@@ -73,17 +66,48 @@ bool Texture2D::loadTexture(const string& fileName, bool generateMipMaps)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 
 	if (generateMipMaps)
 		glGenerateMipmap(GL_TEXTURE_2D);
 
-	stbi_image_free(imageData);
 	glBindTexture(GL_TEXTURE_2D, 0); // unbind texture when done so we don't accidentally mess up our mTexture
 
+	mWidth = width;
+	mHeight = height;
+	mMipMaps = generateMipMaps;
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// GPU memory of the texture; a full mip chain adds a third
+//-----------------------------------------------------------------------------
+std::size_t Texture2D::getMemorySize() const
+{
+	std::size_t size = (std::size_t)mWidth * mHeight * 4;
+	return mMipMaps ? size * 4 / 3 : size;
+}
+
+//-----------------------------------------------------------------------------
+// The GL texture object, 0 until a texture was created
+//-----------------------------------------------------------------------------
+GLuint Texture2D::getHandle() const
+{
+	return mTexture.Get();
+}
+
+//-----------------------------------------------------------------------------
+// Flip while copying, one memcpy per row
+//-----------------------------------------------------------------------------
+void Texture2D::copyFlipped(const unsigned char* src, unsigned char* dst, int width, int height)
+{
+	std::size_t widthInBytes = (std::size_t)width * 4;
+	for (int row = 0; row < height; row++)
+	{
+		std::memcpy(dst + (height - row - 1) * widthInBytes, src + row * widthInBytes, widthInBytes);
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Bind the texture unit passed in as the active texture in the shader
 //-----------------------------------------------------------------------------
@@ -92,7 +116,7 @@ void Texture2D::bind(GLuint texUnit) const
 	assert(texUnit >= 0 && texUnit < 32);
 
 	glActiveTexture(GL_TEXTURE0 + texUnit);
-	glBindTexture(GL_TEXTURE_2D, mTexture);
+	glBindTexture(GL_TEXTURE_2D, mTexture.Get());
 }
 
 //-----------------------------------------------------------------------------
@@ -105,7 +129,6 @@ void Texture2D::unbind(GLuint texUnit) const
 }
 
 bool Texture2D::generateBombingTexture(bool generateMipMaps) {
-	glDeleteTextures(1, &mTexture); // clean old textures
 	int width = 512;
 	int height = width;
 	int numBombs = 1000;
@@ -137,8 +160,8 @@ bool Texture2D::generateBombingTexture(bool generateMipMaps) {
 		}
 	}
 
-	glGenTextures(1, &mTexture);
-	glBindTexture(GL_TEXTURE_2D, mTexture); // all upcoming GL_TEXTURE_2D operations will affect our texture object (mTexture)
+	mTexture.Create(); // replaces (and deletes) the old texture
+	glBindTexture(GL_TEXTURE_2D, mTexture.Get()); // all upcoming GL_TEXTURE_2D operations will affect our texture object (mTexture)
 
 											// Set the texture wrapping/filtering options (on the currently bound texture object)
 											// GL_CLAMP_TO_EDGE
@@ -159,5 +182,9 @@ bool Texture2D::generateBombingTexture(bool generateMipMaps) {
 
 	stbi_image_free(image);
 	glBindTexture(GL_TEXTURE_2D, 0); // unbind texture when done so we don't accidentally mess up our mTexture
+
+	mWidth = width;
+	mHeight = height;
+	mMipMaps = generateMipMaps;
 	return true;
 }
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "TextureLoader.h"
+#include "Texture2D.h"
+#include "ResourceManager.h"
+#include "Utils.h"
+#include <iostream>
+#include "stb_image.h"
+
+TextureLoader::TextureLoader(ResourceManager& resources) :
+	resources(resources),
+	loading(0)
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+	pool.Stop();
+
+	// the GL context may already be gone here, so mapped buffers are left to it
+	for (std::shared_ptr<PendingTexture>& texture : decoded)
+	{
+		stbi_image_free(texture->pixels);
+	}
+}
+
+void TextureLoader::Load(const std::string& fileName, const std::shared_ptr<MeshModel>& model, bool generateMipMaps)
+{
+	std::string fileKey = ResourceManager::GetFileKey(fileName);
+	std::shared_ptr<Texture2D> resident = resources.FindTexture(fileKey);
+	if (resident)
+	{
+		model->SetTexture(resident);
+		return;
+	}
+
+	std::shared_ptr<PendingTexture> texture = std::make_shared<PendingTexture>();
+	texture->model = model;
+	texture->fileName = fileName;
+	texture->fileKey = fileKey;
+	texture->hash = 0;
+	texture->generateMipMaps = generateMipMaps;
+	texture->width = 0;
+	texture->height = 0;
+	texture->pixels = nullptr;
+	texture->pixelBuffer = 0;
+	texture->mappedPixels = nullptr;
+
+	loading++;
+	pool.Submit([this, texture] { Decode(texture); });
+}
+
+bool TextureLoader::IsLoading() const
+{
+	return loading.load() > 0;
+}
+
+void TextureLoader::Decode(std::shared_ptr<PendingTexture> texture)
+{
+	int components;
+	texture->pixels = stbi_load(texture->fileName.c_str(), &texture->width, &texture->height, &components, STBI_rgb_alpha);
+	if (texture->pixels == NULL)
+	{
+		std::cerr << "Error loading texture '" << texture->fileName << "'" << std::endl;
+		loading--;
+		return;
+	}
+
+	int header[3] = { texture->width, texture->height, texture->generateMipMaps };
+	texture->hash = ResourceManager::HashContent(header, sizeof(header));
+	texture->hash = ResourceManager::HashContent(texture->pixels, (std::size_t)texture->width * texture->height * 4, texture->hash);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	decoded.push_back(texture);
+}
+
+void TextureLoader::Stage(std::shared_ptr<PendingTexture> texture)
+{
+	Texture2D::copyFlipped(texture->pixels, static_cast<unsigned char*>(texture->mappedPixels), texture->width, texture->height);
+	stbi_image_free(texture->pixels);
+	texture->pixels = nullptr;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	staged.push_back(texture);
+}
+
+void TextureLoader::Poll()
+{
+	std::vector<std::shared_ptr<PendingTexture>> newlyDecoded;
+	std::vector<std::shared_ptr<PendingTexture>> newlyStaged;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		newlyDecoded.swap(decoded);
+		newlyStaged.swap(staged);
+	}
+
+	for (std::shared_ptr<PendingTexture>& texture : newlyDecoded)
+	{
+		if (texture->model.expired())
+		{
+			stbi_image_free(texture->pixels);
+			loading--;
+			continue;
+		}
+
+		// the same pixels are resident already (a copy of the file, or a load that finished first):
+		// Upload then only assigns them
+		if (resources.FindTexture(texture->hash))
+		{
+			stbi_image_free(texture->pixels);
+			Upload(*texture, NULL);
+			loading--;
+			continue;
+		}
+
+		GLsizeiptr size = (GLsizeiptr)texture->width * texture->height * 4;
+		glGenBuffers(1, &texture->pixelBuffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, texture->pixelBuffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+		texture->mappedPixels = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		if (texture->mappedPixels != NULL)
+		{
+			pool.Submit([this, texture] { Stage(texture); });
+			continue;
+		}
+
+		// no mapping, upload from client memory instead
+		glDeleteBuffers(1, &texture->pixelBuffer);
+		texture->pixelBuffer = 0;
+		std::vector<unsigned char> flipped(size);
+		Texture2D::copyFlipped(texture->pixels, flipped.data(), texture->width, texture->height);
+		stbi_image_free(texture->pixels);
+		Upload(*texture, flipped.data());
+		loading--;
+	}
+
+	for (std::shared_ptr<PendingTexture>& texture : newlyStaged)
+	{
+		Finish(*texture);
+		loading--;
+	}
+}
+
+void TextureLoader::Finish(PendingTexture& texture)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, texture.pixelBuffer);
+	if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE)
+	{
+		// the buffer contents were lost while mapped (e.g. a display mode change)
+		std::cerr << "Error uploading texture '" << texture.fileName << "'" << std::endl;
+	}
+	else
+	{
+		// with the buffer bound, the pixels argument is an offset into it
+		Upload(texture, NULL);
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffers(1, &texture.pixelBuffer);
+}
+
+void TextureLoader::Upload(PendingTexture& texture, const void* pixels)
+{
+	std::shared_ptr<MeshModel> model = texture.model.lock();
+	if (!model)
+	{
+		return;
+	}
+
+	std::shared_ptr<Texture2D> resident = resources.FindTexture(texture.hash);
+	if (!resident)
+	{
+		resident = std::make_shared<Texture2D>();
+		resident->createTexture(texture.width, texture.height, pixels, texture.generateMipMaps);
+	}
+	model->SetTexture(resources.AddTexture(texture.fileKey, texture.hash, Utils::GetFileName(texture.fileName), resident));
+}
@@ -1,11 +1,23 @@
 #include "Utils.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ObjParser.h"
+#include "Parallel.h"
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <math.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UTILS_SSE
+#include <xmmintrin.h>
+#endif
+
 #define PI 3.14159265358979323846 / 180
 
 glm::vec3 Utils::Vec3fFromStream(std::istream& issLine)
@@ -22,99 +34,303 @@ glm::vec2 Utils::Vec2fFromStream(std::istream& issLine)
 	return glm::vec2(x, y);
 }
 
-MeshModel Utils::LoadMeshModel(const std::string& filePath)
+bool Utils::ParseMeshData(const std::string& filePath, MeshData& data, LoadProgress* progress)
 {
-	std::vector<Face> faces;
-	std::vector<glm::vec3> vertices;
-	std::vector<glm::vec3> normals;
-	std::vector<glm::vec2> textureCoords;
-	std::ifstream ifile(filePath.c_str());
-
-	// while not end of file
-	while (!ifile.eof())
+	ObjData obj;
+	if (!ObjParser::ParseFile(filePath, obj, 0, progress) || (progress != nullptr && progress->IsCancelled()))
 	{
-		// get line
-		std::string curLine;
-		std::getline(ifile, curLine);
+		return false;
+	}
 
-		// read the type of the line
-		std::istringstream issLine(curLine);
-		std::string lineType;
+	data.mesh = std::move(obj.mesh);
+	data.vertices = std::move(obj.vertices);
+	data.textureCoords = std::move(obj.textureCoords);
 
-		issLine >> std::ws >> lineType;
+	// normals from the file are used as they are; only if some corner lacks one are they all generated
+	MeshBounds bounds;
+	if (HasFileNormals(data.mesh, obj.normals.size()))
+	{
+		data.normals = std::move(obj.normals);
+		CalculateNormals(data.vertices.data(), data.vertices.size(), nullptr, 0, nullptr, bounds);
+	}
+	else
+	{
+		data.normals.resize(data.vertices.size());
+		CalculateNormals(data.vertices.data(), data.vertices.size(), data.mesh.positionIndices.data(), data.mesh.GetCornerCount(), data.normals.data(), bounds);
+		data.mesh.normalIndices = data.mesh.positionIndices;
+	}
+	data.mins = bounds.mins;
+	data.maxs = bounds.maxs;
+	data.avg = bounds.avg;
 
-		// based on the type parse data
-		if (lineType == "v")
-		{
-			vertices.push_back(Utils::Vec3fFromStream(issLine));
-		}
-		else if (lineType == "vn")
+	if (progress != nullptr)
+	{
+		if (progress->IsCancelled())
+			return false;
+		progress->SetFraction(0.9f);
+	}
+
+	WeldVertices(data);
+
+	return true;
+}
+
+bool Utils::LoadMeshData(const std::string& filePath, MeshData& data, LoadProgress* progress, bool optimize, bool buildLods)
+{
+	// a valid .meshbin next to the file skips parsing and normal generation. Each order has its own,
+	// the file's one still saves the parsing when only the optimized one is missing
+	bool cached;
+	bool staleTime = false;
+	{
+		MeshCache cache;
+		cached = cache.Open(filePath, optimize) || (optimize && cache.Open(filePath, false));
+		if (cached)
 		{
-			normals.push_back(Utils::Vec3fFromStream(issLine));
+			cache.Read(data);
+			staleTime = cache.HasStaleTime();
 		}
-		else if (lineType == "vt")
+	}
+
+	if (!cached && !ParseMeshData(filePath, data, progress))
+	{
+		return false;
+	}
+
+	// the cache is rewritten (closed above, so this works on Windows too) only if something changed.
+	// Optimizing reorders the vertices, so the levels of detail are made again after it. A cache
+	// written without them (no levels at all, not even the full mesh) gets them the first time they are asked for
+	bool changed = !cached;
+	if (optimize && !data.optimized)
+	{
+		MeshOptimizer::Optimize(data);
+		changed = true;
+	}
+	if (buildLods && (changed || data.lods.empty()))
+	{
+		MeshSimplifier::BuildLods(data);
+		changed = true;
+	}
+	else if (changed)
+	{
+		data.lods.clear();
+	}
+	if (changed)
+	{
+		MeshCache::Write(filePath, data);
+	}
+	else if (staleTime)
+	{
+		// the content matched but the time didn't: without the new time every load would hash the source again
+		MeshCache::Restamp(filePath, data.optimized);
+	}
+
+	if (progress != nullptr)
+		progress->SetFraction(1.0f);
+
+	return true;
+}
+
+MeshData Utils::LoadMeshData(const std::string& filePath)
+{
+	// on the main thread, and never drawn far enough away for a level of detail to matter
+	MeshData data;
+	LoadMeshData(filePath, data, nullptr, false, false);
+
+	return data;
+}
+
+std::shared_ptr<MeshModel> Utils::LoadMeshModel(const std::string& filePath)
+{
+	MeshData data;
+	LoadMeshData(filePath, data);
+	return std::make_shared<MeshModel>(std::move(data), Utils::GetFileName(filePath));
+}
+
+//-----------------------------------------------------------------------------
+// Hashes the raw bytes of a vertex, so two corners weld only if every attribute is bit-identical
+//-----------------------------------------------------------------------------
+static std::uint32_t HashVertex(const Vertex& vertex)
+{
+	std::uint32_t words[sizeof(Vertex) / sizeof(std::uint32_t)];
+	std::memcpy(words, &vertex, sizeof(Vertex));
+
+	std::uint32_t hash = 2166136261u;
+	for (std::uint32_t word : words)
+	{
+		hash = (hash ^ word) * 16777619u;
+		hash ^= hash >> 15;
+	}
+	return hash;
+}
+
+void Utils::WeldVertices(MeshData& data)
+{
+	const IndexedMesh& mesh = data.mesh;
+	std::size_t cornerCount = mesh.GetCornerCount();
+
+	data.modelVertices.clear();
+	data.modelVertices.reserve(std::min(cornerCount, data.vertices.size() + data.textureCoords.size()));
+	data.modelIndices.resize(cornerCount);
+
+	// open addressing table of indices into modelVertices, kept at most half full
+	std::size_t tableSize = 16;
+	while (tableSize < 2 * cornerCount)
+		tableSize *= 2;
+	std::vector<std::uint32_t> table(tableSize, IndexedMesh::NoIndex);
+	std::size_t mask = tableSize - 1;
+
+	for (std::size_t i = 0; i < cornerCount; i++) {
+		Vertex vertex;
+		std::uint32_t vertexIndex = mesh.positionIndices[i];
+		std::uint32_t textureCoordsIndex = mesh.textureIndices[i];
+
+		vertex.position = data.vertices[vertexIndex];
+		vertex.normal = data.normals[mesh.normalIndices[i]];
+
+		if (textureCoordsIndex != IndexedMesh::NoIndex)
 		{
-			textureCoords.push_back(Utils::Vec2fFromStream(issLine));
+			vertex.textureCoords = data.textureCoords[textureCoordsIndex];
 		}
-		else if (lineType == "f")
-		{
-			faces.push_back(Face(issLine));
+		else {
+			vertex.textureCoords = glm::vec2(vertex.position);
 		}
-		else if (lineType == "#" || lineType == "")
+
+		std::size_t slot = HashVertex(vertex) & mask;
+		while (table[slot] != IndexedMesh::NoIndex &&
+			std::memcmp(&data.modelVertices[table[slot]], &vertex, sizeof(Vertex)) != 0)
 		{
-			// comment / empty line
+			slot = (slot + 1) & mask;
 		}
-		else
+
+		if (table[slot] == IndexedMesh::NoIndex)
 		{
-			// std::cout << "Found unknown line Type \"" << lineType << "\"" << std::endl;
+			table[slot] = (std::uint32_t)data.modelVertices.size();
+			data.modelVertices.push_back(vertex);
 		}
+		data.modelIndices[i] = table[slot];
 	}
 
-	return MeshModel(faces, vertices, CalculateNormals(vertices, faces), textureCoords, Utils::GetFileName(filePath));
+	data.modelVertices.shrink_to_fit();
 }
 
-std::vector<glm::vec3> Utils::CalculateNormals(std::vector<glm::vec3> vertices, std::vector<Face> faces)
+bool Utils::HasFileNormals(const IndexedMesh& mesh, std::size_t normalCount)
 {
-	std::vector<glm::vec3> normals(vertices.size());
-	std::vector<int> adjacent_faces_count(vertices.size());
+	if (normalCount == 0)
+		return false;
 
-	for (int i = 0; i < adjacent_faces_count.size(); i++)
+	for (std::uint32_t index : mesh.normalIndices)
 	{
-		adjacent_faces_count[i] = 0;
+		if (index == IndexedMesh::NoIndex)
+			return false;
 	}
+	return true;
+}
 
-	for (int i = 0; i < faces.size(); i++)
+void Utils::CalculateNormals(const glm::vec3* vertices, std::size_t vertexCount, const std::uint32_t* indices, std::size_t indexCount, glm::vec3* normals, MeshBounds& bounds, unsigned int threadCount)
+{
+	std::size_t triangleCount = indexCount / 3;
+	unsigned int rangeCount = GetParallelRangeCount(vertexCount, MinNormalRange, threadCount);
+
+	// area weighted face normals (the length of the cross product is twice the area), padded for SIMD loads
+	std::vector<glm::vec4> faceNormals;
+	std::vector<std::uint32_t> offsets;
+	std::vector<std::uint32_t> adjacency;
+	if (normals != nullptr)
 	{
-		Face currentFace = faces.at(i);
-
-		int index0 = currentFace.GetVertexIndex(0) - 1;
-		int index1 = currentFace.GetVertexIndex(1) - 1;
-		int index2 = currentFace.GetVertexIndex(2) - 1;
+		faceNormals.resize(triangleCount);
+		ParallelFor(triangleCount, GetParallelRangeCount(triangleCount, MinNormalRange, threadCount), [&](std::size_t begin, std::size_t end, unsigned int range) {
+			for (std::size_t i = begin; i < end; i++)
+			{
+				const glm::vec3& v0 = vertices[indices[3 * i + 0]];
+				const glm::vec3& v1 = vertices[indices[3 * i + 1]];
+				const glm::vec3& v2 = vertices[indices[3 * i + 2]];
+				faceNormals[i] = glm::vec4(glm::cross(v1 - v0, v2 - v0), 0.0f);
+			}
+		});
+
+		// vertex -> adjacent faces, in one flat array (CSR)
+		offsets.assign(vertexCount + 1, 0);
+		for (std::size_t i = 0; i < indexCount; i++)
+		{
+			offsets[indices[i] + 1]++;
+		}
+		for (std::size_t v = 0; v < vertexCount; v++)
+		{
+			offsets[v + 1] += offsets[v];
+		}
 
-		glm::vec3 v0 = vertices.at(index0);
-		glm::vec3 v1 = vertices.at(index1);
-		glm::vec3 v2 = vertices.at(index2);
+		adjacency.resize(indexCount);
+		std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (std::size_t i = 0; i < indexCount; i++)
+		{
+			adjacency[fill[indices[i]]++] = (std::uint32_t)(i / 3);
+		}
+	}
 
-		glm::vec3 u = v0 - v1;
-		glm::vec3 v = v2 - v1;
-		glm::vec3 face_normal = glm::normalize(-glm::cross(u, v));
+	// every vertex gathers its own faces, so no two threads ever write the same normal
+	std::vector<MeshBounds> rangeBounds(rangeCount);
+	ParallelFor(vertexCount, rangeCount, [&](std::size_t begin, std::size_t end, unsigned int range) {
+		glm::vec3 mins(INFINITY);
+		glm::vec3 maxs(-INFINITY);
+		glm::vec3 sum(0.0f);
 
-		normals.at(index0) += face_normal;
-		normals.at(index1) += face_normal;
-		normals.at(index2) += face_normal;
+		for (std::size_t v = begin; v < end; v++)
+		{
+			const glm::vec3& vertex = vertices[v];
+			mins.x = std::fmin(mins.x, vertex.x);
+			maxs.x = std::fmax(maxs.x, vertex.x);
+			mins.y = std::fmin(mins.y, vertex.y);
+			maxs.y = std::fmax(maxs.y, vertex.y);
+			mins.z = std::fmin(mins.z, vertex.z);
+			maxs.z = std::fmax(maxs.z, vertex.z);
+			sum += vertex;
+
+			if (normals == nullptr)
+				continue;
+
+			const std::uint32_t* face = adjacency.data() + offsets[v];
+			const std::uint32_t* lastFace = adjacency.data() + offsets[v + 1];
+			glm::vec3 normal;
+#ifdef UTILS_SSE
+			__m128 total = _mm_setzero_ps();
+			for (; face < lastFace; face++)
+			{
+				total = _mm_add_ps(total, _mm_loadu_ps(&faceNormals[*face].x));
+			}
+			float lanes[4];
+			_mm_storeu_ps(lanes, total);
+			normal = glm::vec3(lanes[0], lanes[1], lanes[2]);
+#else
+			normal = glm::vec3(0.0f);
+			for (; face < lastFace; face++)
+			{
+				normal += glm::vec3(faceNormals[*face]);
+			}
+#endif
+			float length = glm::length(normal);
+			normals[v] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+		}
 
-		adjacent_faces_count.at(index0) += 1;
-		adjacent_faces_count.at(index1) += 1;
-		adjacent_faces_count.at(index2) += 1;
-	}
+		rangeBounds[range].mins = glm::vec4(mins, 1.0f);
+		rangeBounds[range].maxs = glm::vec4(maxs, 1.0f);
+		rangeBounds[range].avg = sum;
+	});
 
-	for (int i = 0; i < normals.size(); i++)
+	bounds.mins = glm::vec4(glm::vec3(INFINITY), 1.0f);
+	bounds.maxs = glm::vec4(glm::vec3(-INFINITY), 1.0f);
+	bounds.avg = glm::vec3(0.0f);
+	for (const MeshBounds& range : rangeBounds)
 	{
-		normals[i] /= adjacent_faces_count[i];
-		normals[i] = glm::normalize(normals[i]);
+		bounds.mins.x = std::fmin(bounds.mins.x, range.mins.x);
+		bounds.maxs.x = std::fmax(bounds.maxs.x, range.maxs.x);
+		bounds.mins.y = std::fmin(bounds.mins.y, range.mins.y);
+		bounds.maxs.y = std::fmax(bounds.maxs.y, range.maxs.y);
+		bounds.mins.z = std::fmin(bounds.mins.z, range.mins.z);
+		bounds.maxs.z = std::fmax(bounds.maxs.z, range.maxs.z);
+		bounds.avg += range.avg;
 	}
-
-	return normals;
+	if (vertexCount > 0)
+		bounds.avg /= (float)vertexCount;
 }
 
 glm::vec4 Utils::Vec4FromVec3(const glm::vec3& v, const float w) {
@@ -219,13 +435,8 @@ glm::mat4 Utils::GetRotationMatrix(const glm::vec3 rotateVector) {
 }
 
 glm::mat4 Utils::TransMatricesScene(const Scene & scene) {
-	Camera camera = scene.GetActiveCamera();
-
-	glm::mat4
-		cvtMat = camera.GetViewTransformation(),
-		cptMat = camera.GetProjTransformation();
-
-	return cptMat * cvtMat;
+	const CameraState& camera = scene.GetActiveCameraState();
+	return camera.projection * camera.view;
 }
 
 glm::mat4 Utils::TransMatricesModel(const Scene & scene, int modelIdx) {
@@ -256,36 +467,11 @@ glm::vec3 Utils::Mult(glm::mat4 & mat, glm::vec4 & point)
 	return Vec3FromVec4(mat * point);
 }
 
-std::vector<glm::vec3> Utils::FaceToVertices(const Face & face, const std::vector<glm::vec3>& vertices)
-{
-	int i = face.GetVertexIndex(0),
-		j = face.GetVertexIndex(1),
-		k = face.GetVertexIndex(2);
-	std::vector<glm::vec3> v = std::vector<glm::vec3>();
-
-	v.push_back(vertices[i - 1]);
-	v.push_back(vertices[j - 1]);
-	v.push_back(vertices[k - 1]);
-	return v;
-}
-
 glm::vec3 Utils::GetMarbleColor(float val, glm::vec3 c1, glm::vec3 c2) {
 	float x = glm::clamp(val, 0.0f, 1.0f);
 	return glm::mix(c1, c2, x);
 }
 
-std::vector<glm::vec3> Utils::FaceToNormals(const Face & face, const std::vector<glm::vec3>& normals)
-{
-	int i = face.GetNormalIndex(0),
-		j = face.GetNormalIndex(1),
-		k = face.GetNormalIndex(2);
-	std::vector<glm::vec3> v = std::vector<glm::vec3>();
-	v.push_back(normals[i - 1]);
-	v.push_back(normals[j - 1]);
-	v.push_back(normals[k - 1]);
-	return v;
-}
-
 glm::vec4 Utils::GenerateRandomColor()
 {
 	glm::vec4 color(0);
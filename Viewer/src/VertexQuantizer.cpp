@@ -0,0 +1,121 @@
+#include "VertexQuantizer.h"
+#include <cmath>
+#include <cstring>
+
+static std::uint16_t ToUnorm16(float value)
+{
+	value = std::fmin(std::fmax(value, 0.0f), 1.0f);
+	return (std::uint16_t)std::lround(value * 65535.0f);
+}
+
+static std::int16_t ToSnorm16(float value)
+{
+	value = std::fmin(std::fmax(value, -1.0f), 1.0f);
+	return (std::int16_t)std::lround(value * 32767.0f);
+}
+
+void VertexQuantizer::Quantize(const std::vector<Vertex>& vertices, const glm::vec3& mins, const glm::vec3& maxs, std::vector<CompactVertex>& compactVertices)
+{
+	glm::vec3 scale = glm::vec3(1.0f) / GetExtent(mins, maxs);
+
+	compactVertices.resize(vertices.size());
+	for (std::size_t i = 0; i < vertices.size(); i++)
+	{
+		compactVertices[i] = Quantize(vertices[i], mins, scale);
+	}
+}
+
+CompactVertex VertexQuantizer::Quantize(const Vertex& vertex, const glm::vec3& mins, const glm::vec3& scale)
+{
+	CompactVertex compact;
+
+	glm::vec3 position = (vertex.position - mins) * scale;
+	compact.position[0] = ToUnorm16(position.x);
+	compact.position[1] = ToUnorm16(position.y);
+	compact.position[2] = ToUnorm16(position.z);
+	compact.position[3] = 0;
+
+	glm::vec2 normal = OctahedralEncode(vertex.normal);
+	compact.normal[0] = ToSnorm16(normal.x);
+	compact.normal[1] = ToSnorm16(normal.y);
+
+	compact.textureCoords[0] = FloatToHalf(vertex.textureCoords.x);
+	compact.textureCoords[1] = FloatToHalf(vertex.textureCoords.y);
+
+	return compact;
+}
+
+glm::vec3 VertexQuantizer::GetExtent(const glm::vec3& mins, const glm::vec3& maxs)
+{
+	glm::vec3 extent = maxs - mins;
+	for (int i = 0; i < 3; i++)
+	{
+		if (!(extent[i] > 0.0f))
+			extent[i] = 1.0f;
+	}
+	return extent;
+}
+
+//-----------------------------------------------------------------------------
+// Projects the normal onto the octahedron |x| + |y| + |z| = 1 and folds the
+// lower half over the upper one, giving a point in [-1, 1]^2
+//-----------------------------------------------------------------------------
+glm::vec2 VertexQuantizer::OctahedralEncode(const glm::vec3& normal)
+{
+	float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	if (length == 0.0f)
+	{
+		return glm::vec2(0.0f);
+	}
+
+	glm::vec2 encoded = glm::vec2(normal.x, normal.y) / length;
+	if (normal.z < 0.0f)
+	{
+		float x = (1.0f - std::fabs(encoded.y)) * (encoded.x >= 0.0f ? 1.0f : -1.0f);
+		float y = (1.0f - std::fabs(encoded.x)) * (encoded.y >= 0.0f ? 1.0f : -1.0f);
+		encoded = glm::vec2(x, y);
+	}
+	return encoded;
+}
+
+//-----------------------------------------------------------------------------
+// IEEE 754 binary32 -> binary16, round to nearest even
+//-----------------------------------------------------------------------------
+std::uint16_t VertexQuantizer::FloatToHalf(float value)
+{
+	std::uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	std::uint16_t sign = (std::uint16_t)((bits >> 16) & 0x8000);
+	std::uint32_t magnitude = bits & 0x7FFFFFFF;
+
+	// NaN stays NaN, overflow and infinity become infinity
+	if (magnitude > 0x7F800000)
+		return sign | 0x7E00;
+	if (magnitude >= 0x477FF000)
+		return sign | 0x7C00;
+
+	// too small even for a subnormal half
+	if (magnitude < 0x33000000)
+		return sign;
+
+	std::uint32_t exponent = magnitude >> 23;
+	std::uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+	if (exponent < 113)
+	{
+		// subnormal half: shift the mantissa (with its implicit 1) into place
+		std::uint32_t shift = 126 - exponent;
+		std::uint32_t half = mantissa >> shift;
+		std::uint32_t rest = mantissa & ((1u << shift) - 1);
+		std::uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1)))
+			half++;
+		return sign | (std::uint16_t)half;
+	}
+
+	std::uint32_t half = ((exponent - 112) << 10) | ((mantissa >> 13) & 0x3FF);
+	std::uint32_t rest = mantissa & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		half++;
+	return sign | (std::uint16_t)half;
+}
@@ -0,0 +1,74 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned int threadCount) :
+	stopping(false)
+{
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = std::max(hardwareThreads, 2u) - 1;
+	}
+
+	workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.emplace_back(&WorkerPool::Run, this);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	Stop();
+}
+
+void WorkerPool::Submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	wake.notify_one();
+}
+
+void WorkerPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+	}
+}
+
+unsigned int WorkerPool::GetThreadCount() const
+{
+	return (unsigned int)workers.size();
+}
+
+void WorkerPool::Run()
+{
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+			if (tasks.empty())
+			{
+				return;
+			}
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		task();
+	}
+}
@@ -10,6 +10,8 @@
 #include <stdlib.h>
 #include <memory>
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <sstream>
 
 #include "imgui_impl_glfw.h"
@@ -23,6 +25,10 @@
 #include "ImguiMenus.h"
 #include "Light.h"
 #include "Utils.h"
+#include "MeshLoader.h"
+#include "TextureLoader.h"
+#include "ResourceManager.h"
+#include "MeshOptimizer.h"
 
 
 int windowWidth = 1280, windowHeight = 720;
@@ -38,6 +44,7 @@ void StartFrame();
 void RenderFrame(GLFWwindow* window, Scene& scene, Renderer& renderer, ImGuiIO& io);
 void Cleanup(GLFWwindow* window);
 void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
+int PrintCacheStats(const std::string& directory);
 
 void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 {
@@ -51,6 +58,12 @@ int main(int argc, char **argv)
 	// initialize rand
 	srand(static_cast <unsigned> (time(0)));
 
+	// Mesh Viewer --cache-stats [directory]: no window, only what MeshOptimizer does to each model
+	if (argc > 1 && std::string(argv[1]) == "--cache-stats")
+	{
+		return PrintCacheStats(argc > 2 ? argv[2] : "..\\Data\\obj_examples");
+	}
+
 	// Create GLFW window
 	GLFWwindow* window = SetupGlfwWindow(windowWidth, windowHeight, "Mesh Viewer");
 	if (!window)
@@ -64,15 +77,18 @@ int main(int argc, char **argv)
 	// Create the renderer and the scene
 	Renderer renderer;
 	Scene scene;
+	ResourceManager resources;
+	MeshLoader loader(resources);
+	TextureLoader textureLoader(resources);
 
 	r = &renderer;
 	s = &scene;
 
 	renderer.LoadShaders();
 
-	Camera *c = new Camera(glm::vec3(0,0,5), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+	Camera *c = new Camera(resources, glm::vec3(0,0,5), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
 	scene.AddCamera(c);
-	Light *l = new Light();
+	Light *l = new Light(resources);
 	scene.AddLight(l);
 
 	// Setup ImGui
@@ -92,10 +108,15 @@ int main(int argc, char **argv)
     while (!glfwWindowShouldClose(window))
     {
         glfwPollEvents();
+
+		// Upload models and textures that finished loading in the background since the last frame
+		loader.Poll(scene);
+		textureLoader.Poll();
+
 		StartFrame();
 
 		// Here we build the menus for the next frame. Feel free to pass more arguments to this function call
-		DrawImguiMenus(io, scene, renderer);
+		DrawImguiMenus(io, scene, renderer, loader, textureLoader, resources);
 
 		// Render the next frame
 		RenderFrame(window, scene, renderer, io);
@@ -106,6 +127,61 @@ int main(int argc, char **argv)
     return 0;
 }
 
+int PrintCacheStats(const std::string& directory)
+{
+	std::error_code error;
+	std::vector<std::string> files;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		if (entry.path().extension() == ".obj")
+		{
+			files.push_back(entry.path().string());
+		}
+	}
+	if (error || files.empty())
+	{
+		std::cerr << "No .obj files in " << directory << std::endl;
+		return 1;
+	}
+	std::sort(files.begin(), files.end());
+
+	// ACMR: vertices transformed per triangle, ATVR: per vertex of the mesh. Both are 1 at best
+	printf("%-24s %10s %14s %14s\n", "model", "triangles", "ACMR", "ATVR");
+	VertexCacheStats totalBefore = { 0.0f, 0.0f };
+	VertexCacheStats totalAfter = { 0.0f, 0.0f };
+	int loaded = 0;
+	for (const std::string& file : files)
+	{
+		// straight from the file: a report leaves the corpus as it is, and a cache may already be optimized
+		MeshData data;
+		if (!Utils::ParseMeshData(file, data))
+		{
+			std::cerr << "Unable to load " << file << std::endl;
+			continue;
+		}
+
+		VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(data.modelIndices, data.modelVertices.size());
+		MeshOptimizer::Optimize(data);
+		VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(data.modelIndices, data.modelVertices.size());
+
+		printf("%-24s %10zu %6.3f->%6.3f %6.3f->%6.3f\n", Utils::GetFileName(file).c_str(), data.modelIndices.size() / 3,
+			before.acmr, after.acmr, before.atvr, after.atvr);
+		totalBefore.acmr += before.acmr;
+		totalBefore.atvr += before.atvr;
+		totalAfter.acmr += after.acmr;
+		totalAfter.atvr += after.atvr;
+		loaded++;
+	}
+
+	if (loaded == 0)
+	{
+		return 1;
+	}
+	printf("%-24s %10s %6.3f->%6.3f %6.3f->%6.3f\n", "mean", "",
+		totalBefore.acmr / loaded, totalAfter.acmr / loaded, totalBefore.atvr / loaded, totalAfter.atvr / loaded);
+	return 0;
+}
+
 static void GlfwErrorCallback(int error, const char* description)
 {
 	fprintf(stderr, "Glfw Error %d: %s\n", error, description);